@@ -4,9 +4,9 @@
  * It was originally started by Marc Andre Tanner <mat at brain-dump dot org>
  *
  * Each child of the root window is called a client. Clients are organized 
- * in a global linked client list, the focus history is remembered through 
- * a global stack list. Each client contains a bit array to indicate the 
- * tags of a client.
+ * in a global doubly linked client list, the focus history is remembered
+ * through a global doubly linked stack list. Each client contains a bit
+ * array to indicate the tags of a client.
  *
  * Keys and tagging rules are organized as arrays and defined in config.h.
  *
@@ -35,6 +35,7 @@
 #include <dwmapi.h>
 #include <winuser.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <shellapi.h>
@@ -46,6 +47,11 @@
 #include "mods/display.h"
 #include "mods/client.h"
 #include "mods/hotkey.h"
+#include "mods/layout.h"
+
+#include "layout.h"
+#include "match.h"
+#include "win32_utf8.h"
 
 #define NAME                    L"dwm-win32"     /* Used for window name/class */
 
@@ -72,7 +78,10 @@
 #define EVENT_OBJECT_UNCLOAKED 0x8018
 
 enum { CurNormal, CurResize, CurMove, CurLast };        /* cursor */
+enum { AttrTitle, AttrClass, AttrProcess, AttrCloaked, AttrLast }; /* cached client attributes */
 enum { ColBorder, ColFG, ColBG, ColLast };            /* color */
+enum { FieldClass, FieldTitle, FieldProcess, FieldLast }; /* rule fields */
+enum { MatchSubstring, MatchExact, MatchGlob, MatchRegex }; /* rule match modes */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle };    /* clicks */
 
 typedef struct {
@@ -99,6 +108,38 @@ typedef struct {
     const Arg arg;
 } Button;
 
+typedef struct {
+    unsigned int valid; /* bit per Attr* which is up to date */
+    wchar_t title[500];
+    wchar_t classname[256];
+    wchar_t processname[MAX_PATH];
+    bool hasprocessname;
+} ClientAttrs; /* rarely changing window attributes, see attrcached() */
+
+#define PROCCACHESIZE 32
+#define PROCDENIEDTTL 30000 /* ms before an access denied process is asked again */
+
+typedef struct {
+    DWORD pid;          /* 0 if the entry is unused */
+    HANDLE h;           /* NULL if access was denied */
+    DWORD stamp;        /* GetTickCount() at lookup, used to expire denied entries */
+    unsigned int used;  /* LRU clock */
+    wchar_t name[MAX_PATH];
+} ProcEntry; /* see lookupprocess() */
+
+typedef struct {
+    unsigned int hits;
+    uint64_t fetch[FieldLast]; /* QueryPerformanceCounter ticks */
+    uint64_t match;
+} RuleStats; /* see chargerules() */
+
+typedef struct {
+    HWND hwnd; /* NULL if the entry is unused */
+    HWND parent;
+    LONG style, exstyle;
+    bool pok;
+} Rejection; /* an unmanageable window as ismanageable() last saw it */
+
 typedef struct Client Client;
 struct Client {
     HWND hwnd;
@@ -116,10 +157,49 @@ struct Client {
     bool wasvisible;
     bool isfixed, isurgent; // XXX: useless?
     bool iscloaked; // WinStore apps
-    Client *next;
-    Client *snext;
+    bool istiled; /* member of the tiled vector, see updatetiled() */
+    bool isdeferred; /* move is part of the open transaction, see movewindow() */
+    unsigned int gen; /* bumped whenever the pool slot is released */
+    unsigned int slot; /* pool slot number, indexes the tracking bitmaps */
+    uint64_t order; /* ascending in clients list order, see attach() */
+    unsigned int titlerules; /* hash of the matching title rules, see retitle() */
+    ClientAttrs *attrs; /* cold data, lives in the same slab */
+    Client *next, *prev;
+    Client *snext, *sprev;
+    Client *pclient; /* managed client of parent, NULL while orphaned */
+    Client *children, *cnext, *cprev; /* managed children of hwnd, see linkchild() */
+};
+
+typedef struct {
+    Client *c;
+    unsigned int gen;
+} ClientRef; /* weak reference which can outlive the client, see getclientref() */
+
+#define POOLSLABSIZE            64
+#define RETITLETIMER            0x100 /* plus the pool slot, see retitle() */
+#define LAYOUTMEMOSIZE          8     /* remembered layout results, see runlayout() */
+#define MAXLUALAYOUTS           16    /* layouts registered from Lua besides layouts[] */
+#define WM_ARRANGE              (WM_APP + 1) /* posted by arrange(), see flusharrange() */
+
+typedef struct Slab Slab;
+struct Slab {
+    Client clients[POOLSLABSIZE];
+    ClientAttrs attrs[POOLSLABSIZE];
 };
 
+typedef struct {
+    unsigned int n, size;           /* tiled clients, allocated entries */
+    Client **c;                     /* tiled clients on the current tagset in list order */
+    int *x, *y, *w, *h;             /* geometry of each tiled client as computed by the layout */
+} Geometry;
+
+typedef struct {
+    HDWP (WINAPI *begin)(int n);
+    HDWP (WINAPI *defer)(HDWP hdwp, HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags);
+    BOOL (WINAPI *end)(HDWP hdwp);
+    BOOL (WINAPI *move)(HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags);
+} WindowMover; /* how window moves reach the system, see movewindow() */
+
 typedef struct {
     unsigned int mod;
     unsigned int key;
@@ -129,9 +209,18 @@ typedef struct {
 
 typedef struct {
     const wchar_t *symbol;
-    void (*arrange)(void);
+    LayoutFunc arrange;
+    int ref;                        /* Lua function arranging instead, see f_registerlayout() */
 } Layout;
 
+typedef struct {
+    const Layout *layout;           /* NULL if unused */
+    LayoutParams p;
+    unsigned int n, size;           /* rects stored, allocated per coordinate */
+    int *rects;                     /* all x, then y, w and h, size apart */
+    unsigned int stamp;             /* arranges at last use */
+} LayoutMemo;
+
 typedef struct {
     const wchar_t *class;
     const wchar_t *title;
@@ -139,63 +228,116 @@ typedef struct {
     unsigned int tags;
     bool isfloating;
     bool ignoreborder;
+    unsigned int match; /* how class, title and processname are compared, see config.h */
 } Rule;
 
 /* function declarations */
+static bool addrulepattern(Matcher *m, const wchar_t *pattern, unsigned int match, unsigned int id);
+static void adoptchildren(Client *p);
+static Client *allocclient(void);
 static void applyrules(Client *c);
 static void arrange(void);
 static void attach(Client *c);
+static void attachafter(Client *c, Client *p);
 static void attachstack(Client *c);
+static bool attrcached(Client *c, unsigned int attr);
+static void beginmoves(void);
 static void cleanup(lua_State *L);
+static void chargerules(unsigned int field, const unsigned int *alive, uint64_t fetch, uint64_t match);
+static bool checkmanageable(HWND hwnd, HWND parent, LONG style, LONG exstyle, bool pok);
 static void clearurgent(Client *c);
+static int cmporder(const void *a, const void *b);
+static void compileblocklist(void);
+static void compilerules(void);
+static void counttags(unsigned int mask, int n);
+static ClientRef clientref(Client *c);
+static LPWSTR clientclassname(Client *c);
+static LPWSTR clientfield(Client *c, unsigned int field);
+static bool clientcloaked(Client *c);
+static LPWSTR clientprocessname(Client *c);
+static LPWSTR clienttitle(Client *c);
+static void debuglayout(const Layout *l, const LayoutParams *p, const LayoutRects *r);
 static void detach(Client *c);
 static void detachstack(Client *c);
+static void dropprocess(ProcEntry *e);
 static void drawbar(void);
 static void drawsquare(bool filled, bool empty, bool invert, unsigned long col[ColLast]);
 static void drawtext(const wchar_t *text, unsigned long col[ColLast], bool invert);
+static void dumprulestats(FILE *fout);
 void drawborder(Client *c, COLORREF color);
+static void endmoves(void);
 void eprint(bool premortem, const wchar_t *errstr, ...);
 static void focus(Client *c);
 static void focusstack(const Arg *arg);
+static void forgetrejection(HWND hwnd);
 static void movestack(const Arg *arg);
+static void flusharrange(void);
 static void forcearrange(const Arg *arg);
+static void freeclient(Client *c);
 static Client *getclient(HWND hwnd);
+static Client *getclientref(ClientRef ref);
 LPWSTR getclientclassname(HWND hwnd);
 LPWSTR getclienttitle(HWND hwnd);
 LPWSTR getclientprocessname(HWND hwnd);
 HWND getroot(HWND hwnd);
 static void grabkeys(HWND hwnd);
+static void growbitmap(unsigned int **bits, unsigned int from, unsigned int to);
+static void growgeometry(unsigned int size);
+static void growtracking(void);
+static unsigned int hashhwnd(HWND hwnd, unsigned int size);
+static unsigned int hashtitlerules(const unsigned int *alive);
+static void indexclient(Client *c);
+static bool isblocked(const wchar_t *classname, const wchar_t *title);
 static void killclient(const Arg *arg);
+static void linkchild(Client *c);
+static ProcEntry *lookupprocess(DWORD pid);
 static Client *manage(HWND hwnd);
-static void monocle(void);
-static Client *nextchild(Client *p, Client *c);
-static Client *nexttiled(Client *c);
+static void matchrules(Client *c, unsigned int *alive);
+static void movewindow(Client *c);
+static void orphanchildren(Client *p);
 static void quit(const Arg *arg);
+static void rebuildtiled(void);
 static void resize(Client *c, int x, int y, int w, int h);
 static void restack(void);
+static void runlayout(const Layout *l, const LayoutParams *p, const LayoutRects *r);
+static void retitle(Client *c);
+static const wchar_t *rulefield(const Rule *r, unsigned int field);
 static BOOL CALLBACK scan(HWND hwnd, LPARAM lParam);
+static void setbit(unsigned int *bits, unsigned int i, bool on);
 static void setborder(Client *c, bool border);
+static void setfloating(Client *c, bool isfloating);
 static void setvisibility(HWND hwnd, bool visibility);
 static void setlayout(const Arg *arg);
+static void setminimized(Client *c, bool isminimized);
 static void setmfact(const Arg *arg);
+static void settags(Client *c, unsigned int newtags);
 static void setup(lua_State *L, HINSTANCE hInstance);
 static void setupbar(HINSTANCE hInstance);
 static void showclientinfo(const Arg *arg); 
 static void showhide(Client *c);
+static Client *slotclient(unsigned int slot);
 static void spawn(const Arg *arg);
+static void switchtag(unsigned int t);
 static void tag(const Arg *arg);
 static int textnw(const wchar_t *text, unsigned int len);
-static void tile(void);
+static HWND tiledhwnd(unsigned int i);
+static void unindexclient(Client *c);
+static void unlinkchild(Client *c);
 static void togglebar(const Arg *arg);
 static void toggleborder(const Arg *arg);
 static void toggleexplorer(const Arg *arg);
 static void togglefloating(const Arg *arg);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
+static void track(Client *c);
 static void writelog(const Arg *arg);
+static void writestats(void);
 static void unmanage(Client *c);
+static void untile(Client *c);
+static void untrack(Client *c);
 static void updatebar(void);
 static void updategeom(void);
+static void updatetiled(Client *c);
 static void view(const Arg *arg);
 static void zoom(const Arg *arg);
 static bool iscloaked(HWND hwnd);
@@ -203,7 +345,7 @@ static bool iscloaked(HWND hwnd);
 typedef BOOL (*RegisterShellHookWindowProc) (HWND);
 
 static HWND dwmhwnd, barhwnd;
-static HWINEVENTHOOK wineventhook;
+static HWINEVENTHOOK wineventhooks[2];
 static HFONT font;
 static wchar_t stext[256];
 static int sx, sy, sw, sh; /* X display screen geometry x, y, width, height */ 
@@ -212,16 +354,73 @@ static int wx, wy, ww, wh; /* window area geometry x, y, width, height, bar excl
 static unsigned int seltags, sellt;
 
 static Client *clients = NULL;
+static Client *lastclient = NULL;
+static Client *orphans = NULL; /* clients whose parent window isn't managed (yet) */
 static Client *sel = NULL;
 static Client *stack = NULL;
+static Client **clientindex = NULL; /* open addressing HWND -> Client map, see getclient() */
+static unsigned int indexsize, indexcount;
+static Slab **slabs = NULL;         /* Client records are carved out of these, see allocclient() */
+static Client *freeclients = NULL;  /* released pool slots, linked through next */
+static unsigned int nslabs, nclientallocs, nclientfrees;
+static Geometry geom;               /* layout hot path state, see arrange() */
+static LayoutMemo layoutmemo[LAYOUTMEMOSIZE];
+static Layout lualayouts[MAXLUALAYOUTS];
+static unsigned int nlualayouts;
+static lua_State *lua;              /* state the Lua layouts live in */
+static unsigned int memohits, memomisses;
+static unsigned int *tagbits[sizeof(unsigned int) * 8]; /* per tag pool slot membership */
+static unsigned int *floatbits, *minbits;               /* floating and minimized pool slots */
+static unsigned int tagclients[sizeof(unsigned int) * 8]; /* clients per tag, see drawbar() */
+static uint64_t headorder = UINT64_MAX;                 /* order of the current list head */
+static unsigned int attrhits[AttrLast], attrmisses[AttrLast];
+static const char *attrnames[AttrLast] = { "title", "class", "process", "cloaked" };
+static ProcEntry proccache[PROCCACHESIZE]; /* process image names by PID, see lookupprocess() */
+static unsigned int procclock, prochits, procmisses, procexits, procdenied;
+static Rejection rejections[256]; /* direct mapped by hashhwnd(), size is a power of two */
+static unsigned int rejecthits, rejectmisses;
 static Layout *lt[] = { NULL, NULL };
 static UINT shellhookid;    /* Window Message id */
 
+/* window events we listen to, each range gets its own hook so chatty
+ * events in between (EVENT_OBJECT_LOCATIONCHANGE) never reach us.
+ */
+static const DWORD winevents[][2] = {
+    { EVENT_OBJECT_CLOAKED,         EVENT_OBJECT_UNCLOAKED },
+    { EVENT_OBJECT_NAMECHANGE,      EVENT_OBJECT_NAMECHANGE },
+};
+
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { wchar_t limitexceeded[sizeof(unsigned int) * 8 < LENGTH(tags) ? -1 : 1]; };
+struct NumWinEvents { char limitexceeded[LENGTH(wineventhooks) < LENGTH(winevents) ? -1 : 1]; };
+
+#define RULEWORDS (LENGTH(rules) / MATCHBITS + 1)
+static Matcher *rulematchers[FieldLast];           /* per field automaton over rules[], see compilerules() */
+static unsigned int ruleany[FieldLast][RULEWORDS]; /* rules which don't constrain a field */
+static unsigned int rulemask[RULEWORDS];           /* all rules */
+static unsigned int fieldskips[FieldLast];         /* fields applyrules() didn't need to fetch */
+static const char *fieldnames[FieldLast] = { "class", "title", "processname" };
+static unsigned int retitleevents, retitleruns, retitlechanges;
+static unsigned int arranges, resizemoves, resizeskips, visibilitychanges; /* SetWindowPos accounting */
+static bool arrangepending;                        /* WM_ARRANGE is queued, see arrange() */
+static unsigned int arrangerequests;
+static WindowMover mover = { BeginDeferWindowPos, DeferWindowPos, EndDeferWindowPos, SetWindowPos };
+static HDWP movebatch;                             /* open transaction, NULL until the first move */
+static bool batching, batchfailed;                 /* see beginmoves() */
+static unsigned int batchcommits, batchmoves, batchfallbacks;
+static struct {
+    Layout *lt[2];
+    unsigned int sellt;
+    float mfact;
+} pertag[LENGTH(tags) + 1];                        /* layout state of each tag, 0 when all are viewed */
+static unsigned int curtag;                        /* pertag slot lt, sellt and mfact belong to */
+static Matcher *blockedclassmatcher, *blockedtitlematcher; /* see isblocked() */
+static RuleStats rulestats[LENGTH(rules)];
+static unsigned int rulerefs[FieldLast];           /* number of rules constraining a field */
+static LARGE_INTEGER perffreq;
 
 /* elements of the window whose color should be set to the values in the array below */
 static int colorwinelements[] = { COLOR_ACTIVEBORDER, COLOR_INACTIVEBORDER };
@@ -231,17 +430,87 @@ static COLORREF colors[2][LENGTH(colorwinelements)] = {
 };
 
 
+bool
+addrulepattern(Matcher *m, const wchar_t *pattern, unsigned int match, unsigned int id) {
+    switch (match) {
+    case MatchExact:
+        return matchaddexact(m, pattern, id);
+    case MatchGlob:
+        return matchaddglob(m, pattern, id);
+    case MatchRegex:
+        return matchaddregex(m, pattern, id);
+    default:
+        return matchadd(m, pattern, id);
+    }
+}
+
+/* moves orphaned children of p into its child list */
+void
+adoptchildren(Client *p) {
+    Client *c, *t;
+
+    for (c = orphans; c; c = t) {
+        t = c->cnext;
+        if (c->parent == p->hwnd) {
+            unlinkchild(c);
+            linkchild(c);
+        }
+    }
+}
+
+Client *
+allocclient(void) {
+    Client *c;
+    Slab *s;
+    unsigned int i, gen, slot;
+    ClientAttrs *attrs;
+
+    if (!freeclients) {
+        if (!(slabs = realloc(slabs, (nslabs + 1) * sizeof(Slab *))) || !(s = calloc(1, sizeof(Slab))))
+            die(L"fatal: could not calloc() %u bytes for client pool\n", sizeof(Slab));
+        slabs[nslabs] = s;
+        for (i = POOLSLABSIZE; i > 0; i--) {
+            s->clients[i - 1].slot = nslabs * POOLSLABSIZE + i - 1;
+            s->clients[i - 1].attrs = &s->attrs[i - 1];
+            s->clients[i - 1].next = freeclients;
+            freeclients = &s->clients[i - 1];
+        }
+        nslabs++;
+        growtracking();
+    }
+
+    c = freeclients;
+    freeclients = c->next;
+    gen = c->gen;
+    slot = c->slot;
+    attrs = c->attrs;
+    memset(c, 0, sizeof(Client));
+    c->gen = gen;
+    c->slot = slot;
+    c->attrs = attrs;
+    c->attrs->valid = 0;
+    nclientallocs++;
+    return c;
+}
+
 void
 applyrules(Client *c) {
-    unsigned int i;
+    unsigned int i, j, match;
+    unsigned int alive[RULEWORDS];
     Rule *r;
 
-    /* rule matching */
-    for (i = 0; i < LENGTH(rules); i++) {
-        r = &rules[i];
-        if ((!r->title || wcsstr(getclienttitle(c->hwnd), r->title))
-        && (!r->class || wcsstr(getclientclassname(c->hwnd), r->class))
-        && (!r->processname || wcsstr(getclientprocessname(c->hwnd), r->processname))) {
+    memcpy(alive, rulemask, sizeof alive);
+    matchrules(c, alive);
+    c->titlerules = hashtitlerules(alive);
+
+    /* apply in rules[] order, later rules win */
+    for (i = 0; i < RULEWORDS; i++) {
+        match = alive[i];
+        for (j = 0; match; j++, match >>= 1) {
+            if (!(match & 1))
+                continue;
+            r = &rules[i * MATCHBITS + j];
+            rulestats[i * MATCHBITS + j].hits++;
             c->isfloating = r->isfloating;
             c->ignoreborder = r->ignoreborder;
             c->tags |= r->tags & TAGMASK ? r->tags & TAGMASK : tagset[seltags]; 
@@ -251,27 +520,73 @@ applyrules(Client *c) {
         c->tags = tagset[seltags];
 }
 
+/* Asks for the clients to be arranged. All requests made while handling a
+ * burst of events, like an application closing all its windows, share a
+ * single arrange which runs when the posted WM_ARRANGE is dispatched. */
 void
 arrange(void) {
-    showhide(stack);
-    focus(NULL);
-    if (lt[sellt]->arrange)
-        lt[sellt]->arrange();
-    restack();
+    arrangerequests++;
+    if (arrangepending)
+        return;
+    arrangepending = true;
+    if (!PostMessage(dwmhwnd, WM_ARRANGE, 0, 0))
+        flusharrange();
 }
 
 void
 attach(Client *c) {
-    c->next = clients;
-    clients = c;
+    c->order = --headorder;
+    attachafter(c, NULL);
+}
+
+/* links c in after p or at the head of the list if p is NULL */
+void
+attachafter(Client *c, Client *p) {
+    c->prev = p;
+    c->next = p ? p->next : clients;
+    if (c->next)
+        c->next->prev = c;
+    else
+        lastclient = c;
+    if (p)
+        p->next = c;
+    else
+        clients = c;
 }
 
 void
 attachstack(Client *c) {
+    c->sprev = NULL;
     c->snext = stack;
+    if (stack)
+        stack->sprev = c;
     stack = c;
 }
 
+/* returns whether attr of c is up to date and marks it as such,
+ * the caller has to refresh it if false is returned.
+ */
+bool
+attrcached(Client *c, unsigned int attr) {
+    if (c->attrs->valid & 1 << attr) {
+        attrhits[attr]++;
+        return true;
+    }
+    attrmisses[attr]++;
+    c->attrs->valid |= 1 << attr;
+    return false;
+}
+
+/* Makes resize() collect the moves of the tiled clients into one
+ * transaction which endmoves() commits, the windows then change in one
+ * go instead of one repaint after the other. */
+void
+beginmoves(void) {
+    movebatch = NULL;
+    batching = true;
+    batchfailed = false;
+}
+
 void
 buttonpress(unsigned int button, POINTS *point) {
     unsigned int i, x, click;
@@ -306,6 +621,26 @@ buttonpress(unsigned int button, POINTS *point) {
     }
 }
 
+/* splits the cost of fetching and matching a field evenly between the
+ * rules in alive which constrain it, those the field was fetched for */
+void
+chargerules(unsigned int field, const unsigned int *alive, uint64_t fetch, uint64_t match) {
+    unsigned int i, n = 0;
+
+    for (i = 0; i < LENGTH(rules); i++)
+        n += MATCHISSET(alive, i) && !MATCHISSET(ruleany[field], i);
+    if (!n)
+        return;
+    fetch /= n;
+    match /= n;
+    for (i = 0; i < LENGTH(rules); i++) {
+        if (!MATCHISSET(alive, i) || MATCHISSET(ruleany[field], i))
+            continue;
+        rulestats[i].fetch[field] += fetch;
+        rulestats[i].match += match;
+    }
+}
+
 void
 cleanup(lua_State *L) {
     int i;
@@ -321,13 +656,22 @@ cleanup(lua_State *L) {
 
     DeregisterShellHookWindow(dwmhwnd);
 
-    if (wineventhook != NULL)
-        UnhookWinEvent(wineventhook);
+    for (i = 0; i < LENGTH(wineventhooks); i++) {
+        if (wineventhooks[i] != NULL)
+            UnhookWinEvent(wineventhooks[i]);
+        wineventhooks[i] = NULL;
+    }
 
+    /* show every window now, the posted arrange never gets dispatched */
     view(&a);
+    flusharrange();
     lt[sellt] = &foo;
     while (stack)
         unmanage(stack);
+    arrangepending = false;
+
+    for (i = 0; i < PROCCACHESIZE; i++)
+        dropprocess(&proccache[i]);
 
     SetSysColors(LENGTH(colorwinelements), colorwinelements, colors[0]); 
 
@@ -341,6 +685,41 @@ cleanup(lua_State *L) {
     if (font)
         DeleteObject(font);
 
+    free(clientindex);
+    clientindex = NULL;
+    indexsize = indexcount = 0;
+
+    for (i = 0; i < nslabs; i++)
+        free(slabs[i]);
+    free(slabs);
+    slabs = NULL;
+    nslabs = 0;
+    freeclients = NULL;
+
+    growgeometry(0);
+    for (i = 0; i < LENGTH(layoutmemo); i++)
+        free(layoutmemo[i].rects);
+    memset(layoutmemo, 0, sizeof layoutmemo);
+    for (i = 0; i < nlualayouts; i++)
+        free((wchar_t *)lualayouts[i].symbol);
+    memset(lualayouts, 0, sizeof lualayouts);
+    nlualayouts = 0;
+    for (i = 0; i < LENGTH(tags); i++) {
+        free(tagbits[i]);
+        tagbits[i] = NULL;
+    }
+    free(floatbits);
+    free(minbits);
+    floatbits = minbits = NULL;
+
+    for (i = 0; i < FieldLast; i++) {
+        matchfree(rulematchers[i]);
+        rulematchers[i] = NULL;
+    }
+    matchfree(blockedclassmatcher);
+    matchfree(blockedtitlematcher);
+    blockedclassmatcher = blockedtitlematcher = NULL;
+
 	if (L) {
 		lua_close(L);
 		L = NULL;
@@ -352,24 +731,171 @@ clearurgent(Client *c) {
     c->isurgent = false;
 }
 
+LPWSTR
+clientclassname(Client *c) {
+    if (!attrcached(c, AttrClass))
+        GetClassNameW(c->hwnd, c->attrs->classname, LENGTH(c->attrs->classname));
+    return c->attrs->classname;
+}
+
+LPWSTR
+clientfield(Client *c, unsigned int field) {
+    switch (field) {
+    case FieldClass:
+        return clientclassname(c);
+    case FieldTitle:
+        return clienttitle(c);
+    default:
+        return clientprocessname(c);
+    }
+}
+
+bool
+clientcloaked(Client *c) {
+    if (!attrcached(c, AttrCloaked))
+        c->iscloaked = iscloaked(c->hwnd);
+    return c->iscloaked;
+}
+
+/* the image of a window never changes, so failures are cached as well */
+LPWSTR
+clientprocessname(Client *c) {
+    LPWSTR processname;
+
+    if (!attrcached(c, AttrProcess)) {
+        processname = getclientprocessname(c->hwnd);
+        if ((c->attrs->hasprocessname = processname != NULL))
+            wcscpy(c->attrs->processname, processname);
+    }
+    return c->attrs->hasprocessname ? c->attrs->processname : NULL;
+}
+
+LPWSTR
+clienttitle(Client *c) {
+    if (!attrcached(c, AttrTitle))
+        GetWindowTextW(c->hwnd, c->attrs->title, LENGTH(c->attrs->title));
+    return c->attrs->title;
+}
+
+ClientRef
+clientref(Client *c) {
+    ClientRef ref = { .c = c, .gen = c ? c->gen : 0 };
+    return ref;
+}
+
+int
+cmporder(const void *a, const void *b) {
+    const Client *ca = *(Client * const *)a, *cb = *(Client * const *)b;
+
+    return ca->order < cb->order ? -1 : ca->order > cb->order;
+}
+
 void
-detach(Client *c) {
-    Client **tc;
+compileblocklist(void) {
+    unsigned int i;
+
+    if (!(blockedclassmatcher = matchnew(0)) || !(blockedtitlematcher = matchnew(0)))
+        die(L"Error allocating blocklist matcher");
+    for (i = 0; i < LENGTH(blockedclasses); i++)
+        if (!matchadd(blockedclassmatcher, blockedclasses[i], 0))
+            die(L"Error compiling blocklist");
+    for (i = 0; i < LENGTH(blockedcorewindows); i++)
+        if (!matchadd(blockedtitlematcher, blockedcorewindows[i], 0))
+            die(L"Error compiling blocklist");
+    if (!matchcompile(blockedclassmatcher) || !matchcompile(blockedtitlematcher))
+        die(L"Error compiling blocklist");
+}
+
+/* builds one matcher per rule field, rule i reports as id i. Class and
+ * executable names are case insensitive on Windows, titles are not. A
+ * glob or regex which doesn't compile is fatal. */
+void
+compilerules(void) {
+    unsigned int i, f;
+    const wchar_t *pattern;
+
+    for (f = 0; f < FieldLast; f++)
+        if (!(rulematchers[f] = matchnew(f == FieldTitle ? 0 : MatchFoldCase)))
+            die(L"Error allocating rule matcher");
 
-    for (tc = &clients; *tc && *tc != c; tc = &(*tc)->next);
-    *tc = c->next;
+    for (i = 0; i < LENGTH(rules); i++) {
+        MATCHSET(rulemask, i);
+        for (f = 0; f < FieldLast; f++) {
+            if (!(pattern = rulefield(&rules[i], f))) {
+                MATCHSET(ruleany[f], i);
+                continue;
+            }
+            if (!addrulepattern(rulematchers[f], pattern, rules[i].match, i))
+                die(L"Error compiling rule %d", i);
+            rulerefs[f]++;
+        }
+    }
+
+    for (f = 0; f < FieldLast; f++)
+        if (!matchcompile(rulematchers[f]))
+            die(L"Error compiling rules");
+}
+
+/* keeps the bar from walking all clients whenever it is drawn */
+void
+counttags(unsigned int mask, int n) {
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(tags); i++)
+        if (mask & 1 << i)
+            tagclients[i] += n;
+}
+
+/* reports rects breaking the layout invariants in debug builds */
+void
+debuglayout(const Layout *l, const LayoutParams *p, const LayoutRects *r) {
+#ifndef NDEBUG
+    const char *err;
+    unsigned int bad;
+
+    /* grid leaves the cells after the last client empty, Lua layouts may too */
+    if ((err = checklayout(p, geom.n, r, l->arrange != grid && !l->ref, &bad)))
+        debug(L"layout %s: %hs at rect %u of %u\n", l->symbol, err, bad, geom.n);
+#endif
+}
+
+void
+detach(Client *c) {
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        clients = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+    else
+        lastclient = c->prev;
+    c->next = c->prev = NULL;
 }
 
 void
 detachstack(Client *c) {
-    Client **tc;
+    if (c->sprev)
+        c->sprev->snext = c->snext;
+    else
+        stack = c->snext;
+    if (c->snext)
+        c->snext->sprev = c->sprev;
+    c->snext = c->sprev = NULL;
+}
 
-    for (tc = &stack; *tc && *tc != c; tc = &(*tc)->snext);
-    *tc = c->snext;
+void
+dropprocess(ProcEntry *e) {
+    if (e->h)
+        CloseHandle(e->h);
+    e->pid = 0;
+    e->h = NULL;
+    e->used = 0;
 }
 
 void
 drawbar(void) {
+    if (!barhwnd)
+        return; /* not created yet, GetWindowDC(NULL) is the whole screen */
     dc.hdc = GetWindowDC(barhwnd);
 
     dc.h = bh;
@@ -377,18 +903,16 @@ drawbar(void) {
     int x;
     unsigned int i, occ = 0, urg = 0;
     unsigned long *col;
-    Client *c;
     time_t timer;
     struct tm date;
     wchar_t timestr[256];
     wchar_t localtimestr[256];
     wchar_t utctimestr[256];
 
-    for (c = clients; c; c = c->next) {
-        occ |= c->tags;
-        if (c->isurgent)
-            urg |= c->tags;
-    }
+    /* nothing sets isurgent, so only the occupied tags are shown */
+    for (i = 0; i < LENGTH(tags); i++)
+        if (tagclients[i])
+            occ |= 1 << i;
 
     dc.x = 0;
     for (i = 0; i < LENGTH(tags); i++) {
@@ -437,7 +961,7 @@ drawbar(void) {
     if ((dc.w = dc.x - x) > bh) {
         dc.x = x;
         if (sel) {
-            drawtext(getclienttitle(sel->hwnd), dc.sel, false);
+            drawtext(clienttitle(sel), dc.sel, false);
             drawsquare(sel->isfixed, sel->isfloating, false, dc.sel);
         }
         else
@@ -489,6 +1013,25 @@ drawtext(const wchar_t *text, unsigned long col[ColLast], bool invert) {
     DrawTextW(dc.hdc, text, -1, &r, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
 }
 
+void
+endmoves(void) {
+    unsigned int i;
+
+    if (movebatch && !mover.end(movebatch)) {
+        /* unknown which moves made it, apply them all one by one */
+        for (i = 0; i < geom.n; i++)
+            if (geom.c[i]->isdeferred) {
+                mover.move(geom.c[i]->hwnd, HWND_TOP, geom.c[i]->x, geom.c[i]->y, geom.c[i]->w, geom.c[i]->h, SWP_NOACTIVATE);
+                batchfallbacks++;
+            }
+    } else if (movebatch)
+        batchcommits++;
+    for (i = 0; i < geom.n; i++)
+        geom.c[i]->isdeferred = false;
+    movebatch = NULL;
+    batching = false;
+}
+
 void
 eprint(bool premortem, const wchar_t *errstr, ...) {
     va_list ap;
@@ -551,6 +1094,57 @@ setselected(Client *c) {
     drawbar();
 }
 
+/* one line per rule, times are in microseconds */
+void
+dumprulestats(FILE *fout) {
+    unsigned int i, f;
+    const wchar_t *pattern;
+    char *utf8;
+    double us = perffreq.QuadPart ? 1e6 / perffreq.QuadPart : 0;
+
+    fprintf(fout, "rule,class,title,processname,hits,fetch.class,fetch.title,fetch.process,match\n");
+    for (i = 0; i < LENGTH(rules); i++) {
+        fprintf(fout, "%u", i);
+        for (f = 0; f < FieldLast; f++) {
+            fprintf(fout, ",");
+            if ((pattern = rulefield(&rules[i], f)) && (utf8 = utf16_to_utf8(pattern))) {
+                fprintf(fout, "\"%s\"", utf8);
+                free(utf8);
+            }
+        }
+        fprintf(fout, ",%u", rulestats[i].hits);
+        for (f = 0; f < FieldLast; f++)
+            fprintf(fout, ",%.1f", rulestats[i].fetch[f] * us);
+        fprintf(fout, ",%.1f\n", rulestats[i].match * us);
+    }
+}
+
+/* runs a pending arrange right away */
+void
+flusharrange(void) {
+    LayoutParams p = { wx, wy, ww, wh, mfact * (1 << MFACTBITS) + 0.5, bh };
+    LayoutRects r = { geom.x, geom.y, geom.w, geom.h };
+    unsigned int i;
+    Client *c;
+
+    if (!arrangepending)
+        return;
+    arrangepending = false;
+    showhide(stack);
+    focus(NULL);
+    arranges++;
+    if (lt[sellt]->arrange) {
+        runlayout(lt[sellt], &p, &r);
+        beginmoves();
+        for (i = 0; i < geom.n; i++) {
+            c = geom.c[i];
+            resize(c, geom.x[i], geom.y[i], geom.w[i] - 2 * c->bw, geom.h[i] - 2 * c->bw);
+        }
+        endmoves();
+    }
+    restack();
+}
+
 void
 focus(Client *c) {
     setselected(c);
@@ -560,7 +1154,7 @@ focus(Client *c) {
 
 void
 focusstack(const Arg *arg) {
-    Client *c = NULL, *i;
+    Client *c;
 
     if (!sel)
         return;
@@ -570,13 +1164,9 @@ focusstack(const Arg *arg) {
             for (c = clients; c && !ISFOCUSABLE(c); c = c->next);
     }
     else {
-        for (i = clients; i != sel; i = i->next)
-            if (ISFOCUSABLE(i))
-                c = i;
+        for (c = sel->prev; c && !ISFOCUSABLE(c); c = c->prev);
         if (!c)
-            for (; i; i = i->next)
-                if (ISFOCUSABLE(i))
-                    c = i;
+            for (c = lastclient; c && !ISFOCUSABLE(c); c = c->prev);
     }
     if (c) {
         focus(c);
@@ -591,71 +1181,86 @@ managechildwindows(Client *p) {
     /* remove all child windows which were not part
      * of the enumeration above.
      */
-    for (c = clients; c; ) {
-        if (c->parent == p->hwnd) {
-            /* XXX: ismanageable isn't that reliable or some
-             *      windows change over time which means they
-             *      were once reported as manageable but not
-             *      this time so we also check if they are
-             *      currently visible and if that's the case
-             *      we keep them in our client list.
-             */
-            if (!c->isalive && !IsWindowVisible(c->hwnd)) {
-                t = c->next;
-                unmanage(c);
-                c = t;
-                continue;
-            }
-
-            /* reset flag for next check */
-            c->isalive = false;
+    for (c = p->children; c; c = t) {
+        t = c->cnext;
+        /* XXX: ismanageable isn't that reliable or some
+         *      windows change over time which means they
+         *      were once reported as manageable but not
+         *      this time so we also check if they are
+         *      currently visible and if that's the case
+         *      we keep them in our client list.
+         */
+        if (!c->isalive && !IsWindowVisible(c->hwnd)) {
+            unmanage(c);
+            continue;
         }
-        c = c->next;
+
+        /* reset flag for next check */
+        c->isalive = false;
     }
 
-    return nextchild(p, clients);
+    return p->children;
+}
+
+void
+forgetrejection(HWND hwnd) {
+    Rejection *r = &rejections[hashhwnd(hwnd, LENGTH(rejections))];
+
+    if (r->hwnd == hwnd)
+        r->hwnd = NULL;
+}
+
+void
+freeclient(Client *c) {
+    /* invalidate every ClientRef still pointing to this slot */
+    c->gen++;
+    c->hwnd = NULL;
+    c->next = freeclients;
+    freeclients = c;
+    nclientfrees++;
+}
+
+Client *
+getclientref(ClientRef ref) {
+    return ref.c && ref.c->gen == ref.gen ? ref.c : NULL;
 }
 
 Client *
 getclient(HWND hwnd) {
-    Client *c;
+    unsigned int i;
 
-    for (c = clients; c; c = c->next)
-        if (c->hwnd == hwnd)
-            return c;
+    if (!indexcount)
+        return NULL;
+    for (i = hashhwnd(hwnd, indexsize); clientindex[i]; i = (i + 1) & (indexsize - 1))
+        if (clientindex[i]->hwnd == hwnd)
+            return clientindex[i];
     return NULL;
 }
 
 LPWSTR
 getclientclassname(HWND hwnd) {
-    static wchar_t buf[500];
-    GetClassNameW(hwnd, buf, sizeof buf);
+    static wchar_t buf[256];
+    GetClassNameW(hwnd, buf, LENGTH(buf));
     return buf;
 }
 
 LPWSTR
 getclienttitle(HWND hwnd) {
     static wchar_t buf[500];
-    GetWindowTextW(hwnd, buf, sizeof buf);
+    GetWindowTextW(hwnd, buf, LENGTH(buf));
     return buf;
 }
 
 LPWSTR
 getclientprocessname(HWND hwnd) {
     DWORD processid = 0;
-    DWORD buf_size = MAX_PATH;
-    static wchar_t buf[MAX_PATH];
+    ProcEntry *e;
+
     GetWindowThreadProcessId(hwnd, &processid);
-    HANDLE hProc = OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, processid);
-    if (hProc) {
-        if (QueryFullProcessImageNameW(hProc, 0, buf, &buf_size)) {
-            CloseHandle(hProc);
-            return buf;
-        } else {
-            CloseHandle(hProc);
-        }
-    }
-    return NULL;
+    if (!processid)
+        return NULL;
+    e = lookupprocess(processid);
+    return e->h ? e->name : NULL;
 }
 
 
@@ -677,6 +1282,124 @@ grabkeys(HWND hwnd) {
     }
 }
 
+void
+growbitmap(unsigned int **bits, unsigned int from, unsigned int to) {
+    if (!(*bits = realloc(*bits, to * sizeof(unsigned int))))
+        die(L"fatal: could not realloc() %u bytes for client tracking\n", to * sizeof(unsigned int));
+    memset(*bits + from, 0, (to - from) * sizeof(unsigned int));
+}
+
+/* size 0 releases the arrays */
+void
+growgeometry(unsigned int size) {
+    if (!size) {
+        free(geom.c);
+        free(geom.x);
+        free(geom.y);
+        free(geom.w);
+        free(geom.h);
+        memset(&geom, 0, sizeof geom);
+        return;
+    }
+
+    if (!(geom.c = realloc(geom.c, size * sizeof(Client *)))
+    || !(geom.x = realloc(geom.x, size * sizeof(int)))
+    || !(geom.y = realloc(geom.y, size * sizeof(int)))
+    || !(geom.w = realloc(geom.w, size * sizeof(int)))
+    || !(geom.h = realloc(geom.h, size * sizeof(int))))
+        die(L"fatal: could not realloc() geometry arrays for %u clients\n", size);
+    geom.size = size;
+}
+
+/* called whenever the pool grows by one slab */
+void
+growtracking(void) {
+    unsigned int i, from = (nslabs - 1) * POOLSLABSIZE / 32, to = nslabs * POOLSLABSIZE / 32;
+
+    for (i = 0; i < LENGTH(tags); i++)
+        growbitmap(&tagbits[i], from, to);
+    growbitmap(&floatbits, from, to);
+    growbitmap(&minbits, from, to);
+}
+
+unsigned int
+hashhwnd(HWND hwnd, unsigned int size) {
+    /* window handles are small, mostly sequential values, fibonacci
+     * hashing spreads them over the whole table. size is a power of two.
+     */
+    return (unsigned int)(((uint64_t)(uintptr_t)hwnd * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+}
+
+/* FNV-1a over the title constraining rules in alive */
+unsigned int
+hashtitlerules(const unsigned int *alive) {
+    unsigned int i, h = 2166136261u;
+
+    for (i = 0; i < RULEWORDS; i++) {
+        h ^= alive[i] & ~ruleany[FieldTitle][i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void
+indexclient(Client *c) {
+    Client **old = clientindex;
+    unsigned int i, oldsize = indexsize;
+
+    /* keep the load factor below 1/2 so probe sequences stay short */
+    if (2 * (indexcount + 1) > indexsize) {
+        indexsize = indexsize ? 2 * indexsize : 64;
+        if (!(clientindex = calloc(indexsize, sizeof(Client *))))
+            die(L"fatal: could not calloc() %u bytes for client index\n", indexsize * sizeof(Client *));
+        indexcount = 0;
+        for (i = 0; i < oldsize; i++)
+            if (old[i])
+                indexclient(old[i]);
+        free(old);
+    }
+
+    for (i = hashhwnd(c->hwnd, indexsize); clientindex[i]; i = (i + 1) & (indexsize - 1))
+        if (clientindex[i] == c)
+            return;
+    clientindex[i] = c;
+    indexcount++;
+}
+
+void
+unindexclient(Client *c) {
+    unsigned int i, j, h;
+
+    if (!indexcount)
+        return;
+    for (i = hashhwnd(c->hwnd, indexsize); clientindex[i] != c; i = (i + 1) & (indexsize - 1))
+        if (!clientindex[i])
+            return;
+
+    /* backward shift deletion, no tombstones are left behind */
+    for (j = (i + 1) & (indexsize - 1); clientindex[j]; j = (j + 1) & (indexsize - 1)) {
+        h = hashhwnd(clientindex[j]->hwnd, indexsize);
+        if (((j - h) & (indexsize - 1)) >= ((j - i) & (indexsize - 1))) {
+            clientindex[i] = clientindex[j];
+            i = j;
+        }
+    }
+    clientindex[i] = NULL;
+    indexcount--;
+}
+
+/* a single scan of classname, and of title for CoreWindows, against the
+ * blocklists from config.h */
+bool
+isblocked(const wchar_t *classname, const wchar_t *title) {
+    unsigned int found = 0;
+
+    matchrun(blockedclassmatcher, classname, &found);
+    if (!found && wcsstr(classname, L"Windows.UI.Core.CoreWindow"))
+        matchrun(blockedtitlematcher, title, &found);
+    return found;
+}
+
 bool
 iscloaked(HWND hwnd) {
     int cloaked_val;
@@ -690,6 +1413,8 @@ iscloaked(HWND hwnd) {
 
 bool
 ismanageable(HWND hwnd) {
+    Rejection *r;
+
     if (hwnd == 0)
         return false;
 
@@ -700,6 +1425,30 @@ ismanageable(HWND hwnd) {
     int style = GetWindowLong(hwnd, GWL_STYLE);
     int exstyle = GetWindowLong(hwnd, GWL_EXSTYLE);
     bool pok = (parent != 0 && ismanageable(parent));
+
+    /* A rejection stays valid while the window looks the same. Showing
+     * or hiding it flips WS_VISIBLE in its style, events which may change
+     * the outcome otherwise drop it, see forgetrejection(). */
+    r = &rejections[hashhwnd(hwnd, LENGTH(rejections))];
+    if (r->hwnd == hwnd && r->parent == parent && r->style == style && r->exstyle == exstyle
+    && r->pok == pok && (!pok || getclient(parent))) {
+        rejecthits++;
+        return false;
+    }
+    rejectmisses++;
+
+    if (checkmanageable(hwnd, parent, style, exstyle, pok))
+        return true;
+    r->hwnd = hwnd;
+    r->parent = parent;
+    r->style = style;
+    r->exstyle = exstyle;
+    r->pok = pok;
+    return false;
+}
+
+bool
+checkmanageable(HWND hwnd, HWND parent, LONG style, LONG exstyle, bool pok) {
     bool istool = exstyle & WS_EX_TOOLWINDOW;
     bool isapp = exstyle & WS_EX_APPWINDOW;
     bool noactiviate = exstyle & WS_EX_NOACTIVATE;
@@ -740,28 +1489,8 @@ ismanageable(HWND hwnd) {
     if (iscloaked(hwnd))
         return false;
 
-    if (wcsstr(classname, L"Windows.UI.Core.CoreWindow") && (
-        wcsstr(title, L"Windows Shell Experience Host") ||
-        wcsstr(title, L"Microsoft Text Input Application") ||
-        wcsstr(title, L"Action center") ||
-        wcsstr(title, L"New Notification") ||
-        wcsstr(title, L"Date and Time Information") ||
-        wcsstr(title, L"Volume Control") ||
-        wcsstr(title, L"Network Connections") ||
-        wcsstr(title, L"Cortana") ||
-        wcsstr(title, L"Start") ||
-        wcsstr(title, L"Windows Default Lock Screen") ||
-        wcsstr(title, L"Search"))) {
+    if (isblocked(classname, title))
         return false;
-    }
-
-    if (wcsstr(classname, L"ForegroundStaging") ||
-        wcsstr(classname, L"ApplicationManager_DesktopShellWindow") ||
-        wcsstr(classname, L"Static") ||
-        wcsstr(classname, L"Scrollbar") ||
-        wcsstr(classname, L"Progman")) {
-        return false;
-    }
 
     /*
      *    WS_EX_APPWINDOW
@@ -802,6 +1531,65 @@ killclient(const Arg *arg) {
     PostMessage(sel->hwnd, WM_CLOSE, 0, 0);
 }
 
+/* puts c into the child list of its parent client, or into the
+ * orphans list until the parent window gets managed.
+ */
+void
+linkchild(Client *c) {
+    Client **head;
+
+    if (!c->parent)
+        return;
+    c->pclient = getclient(c->parent);
+    head = c->pclient ? &c->pclient->children : &orphans;
+    c->cprev = NULL;
+    c->cnext = *head;
+    if (*head)
+        (*head)->cprev = c;
+    *head = c;
+}
+
+/* The cache entry holds a SYNCHRONIZE handle to the process which keeps
+ * its PID from being reused, once the process exits the handle becomes
+ * signaled and the entry is dropped. Processes we may not open (elevated
+ * ones) are remembered for PROCDENIEDTTL, the PID might be reused by then. */
+ProcEntry *
+lookupprocess(DWORD pid) {
+    ProcEntry *e, *lru = &proccache[0];
+    DWORD size = MAX_PATH;
+
+    for (e = proccache; e < proccache + PROCCACHESIZE; e++) {
+        if (e->pid == pid) {
+            if (e->h ? WaitForSingleObject(e->h, 0) == WAIT_TIMEOUT
+                    : GetTickCount() - e->stamp < PROCDENIEDTTL) {
+                e->used = ++procclock;
+                prochits++;
+                return e;
+            }
+            if (e->h)
+                procexits++;
+            dropprocess(e);
+        }
+        if (e->used < lru->used)
+            lru = e;
+    }
+
+    procmisses++;
+    dropprocess(lru);
+    e = lru;
+    e->pid = pid;
+    e->stamp = GetTickCount();
+    e->used = ++procclock;
+    e->h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid);
+    if (e->h && !QueryFullProcessImageNameW(e->h, 0, e->name, &size)) {
+        CloseHandle(e->h);
+        e->h = NULL;
+    }
+    if (!e->h)
+        procdenied++;
+    return e;
+}
+
 Client*
 manage(HWND hwnd) {    
     Client *c = getclient(hwnd);
@@ -818,14 +1606,12 @@ manage(HWND hwnd) {
     if (!GetWindowInfo(hwnd, &wi))
         return NULL;
 
-    if (!(c = calloc(1, sizeof(Client))))
-        die(L"fatal: could not calloc() %u bytes for new client\n", sizeof(Client));
+    c = allocclient();
 
     c->hwnd = hwnd;
     c->parent = GetParent(hwnd);
     c->root = getroot(hwnd);
     c->isalive = true;
-    c->iscloaked = iscloaked(hwnd);
     c->isminimized = IsIconic(hwnd);
 
     static WINDOWPLACEMENT wp = {
@@ -838,7 +1624,7 @@ manage(HWND hwnd) {
     
     c->isfloating = (!(wi.dwStyle & WS_MINIMIZEBOX) && !(wi.dwStyle & WS_MAXIMIZEBOX));
 
-    c->ignoreborder = iscloaked(hwnd);
+    c->ignoreborder = clientcloaked(c);
 
     debug(L" window style: %d\n", wi.dwStyle);
     debug(L"     minimize: %d\n", wi.dwStyle & WS_MINIMIZEBOX);
@@ -859,28 +1645,63 @@ manage(HWND hwnd) {
 
     attach(c);
     attachstack(c);
+    indexclient(c);
+    track(c);
+    linkchild(c);
+    adoptchildren(c);
     return c;
 }
 
+/* narrows alive down to the rules which match c */
 void
-monocle(void) {
-    Client *c;
-
-    for (c = nexttiled(clients); c; c = nexttiled(c->next)) {
-        resize(c, wx, wy, ww - 2 * c->bw, wh - 2 * c->bw);
+matchrules(Client *c, unsigned int *alive) {
+    unsigned int i, f, need;
+    unsigned int set[RULEWORDS];
+    LARGE_INTEGER t0, t1, t2;
+    LPWSTR text, name;
+
+    /* Fields are fetched in FieldClass, FieldTitle, FieldProcess order,
+     * cheapest first, each at most once and only while a rule which
+     * constrains it can still match. A rule matches if all its fields do.
+     */
+    for (f = 0; f < FieldLast; f++) {
+        for (need = 0, i = 0; i < RULEWORDS; i++)
+            need |= alive[i] & ~ruleany[f][i];
+        if (!need) {
+            fieldskips[f]++;
+            continue;
+        }
+        memcpy(set, ruleany[f], sizeof set);
+        QueryPerformanceCounter(&t0);
+        text = clientfield(c, f);
+        QueryPerformanceCounter(&t1);
+        if (text) {
+            matchrun(rulematchers[f], text, set);
+            /* exact and glob process rules name the executable, not its path */
+            if (f == FieldProcess && (name = wcsrchr(text, L'\\')))
+                text = name + 1;
+            matchexact(rulematchers[f], text, set);
+        }
+        QueryPerformanceCounter(&t2);
+        chargerules(f, alive, t1.QuadPart - t0.QuadPart, t2.QuadPart - t1.QuadPart);
+        for (i = 0; i < RULEWORDS; i++)
+            alive[i] &= set[i];
     }
 }
 
-Client *
-nextchild(Client *p, Client *c) {
-    for (; c && c->parent != p->hwnd; c = c->next);
-    return c;
-}
+void
+orphanchildren(Client *p) {
+    Client *c;
 
-Client *
-nexttiled(Client *c) {
-    for (; c && (c->isfloating || c->isminimized || !ISVISIBLE(c)); c = c->next);
-    return c;
+    while ((c = p->children)) {
+        unlinkchild(c);
+        c->pclient = NULL;
+        c->cnext = orphans;
+        c->cprev = NULL;
+        if (orphans)
+            orphans->cprev = c;
+        orphans = c;
+    }
 }
 
 void
@@ -888,6 +1709,35 @@ quit(const Arg *arg) {
     PostMessage(dwmhwnd, WM_CLOSE, 0, 0);
 }
 
+/* collects the tiled vector from the tracking bitmaps, used whenever
+ * the tagset changes. Everything else goes through updatetiled().
+ */
+void
+rebuildtiled(void) {
+    unsigned int i, w, b, bits, words = nslabs * POOLSLABSIZE / 32;
+
+    for (i = 0; i < geom.n; i++)
+        geom.c[i]->istiled = false;
+    geom.n = 0;
+
+    for (w = 0; w < words; w++) {
+        for (bits = 0, i = 0; i < LENGTH(tags); i++)
+            if (tagset[seltags] & 1 << i)
+                bits |= tagbits[i][w];
+        bits &= ~floatbits[w] & ~minbits[w];
+        for (b = 0; bits; b++, bits >>= 1) {
+            if (!(bits & 1))
+                continue;
+            if (geom.n == geom.size)
+                growgeometry(geom.size ? 2 * geom.size : 64);
+            geom.c[geom.n] = slotclient(w * 32 + b);
+            geom.c[geom.n++]->istiled = true;
+        }
+    }
+    if (geom.n > 1)
+        qsort(geom.c, geom.n, sizeof(Client *), cmporder);
+}
+
 void
 resize(Client *c, int x, int y, int w, int h) {
     if (w <= 0 && h <= 0) {
@@ -911,9 +1761,51 @@ resize(Client *c, int x, int y, int w, int h) {
         c->y = y;
         c->w = w;
         c->h = h;
-        debug(L" resize %d: %s: x: %d y: %d w: %d h: %d\n", c->hwnd, getclienttitle(c->hwnd), x, y, w, h);
-        SetWindowPos(c->hwnd, HWND_TOP, c->x, c->y, c->w, c->h, SWP_NOACTIVATE);
+        debug(L" resize %d: %s: x: %d y: %d w: %d h: %d\n", c->hwnd, clienttitle(c), x, y, w, h);
+        movewindow(c);
+        resizemoves++;
+    } else
+        resizeskips++;
+}
+
+/* Applies the rules which constrain the title again once a title change
+ * settled, class and process name come from the attribute cache. Only
+ * a change in the set of matching title rules is acted upon, so busy
+ * retitling windows like terminals cost a rule scan at most. Tags are
+ * added as applyrules() does, a window keeps them when its title stops
+ * matching. */
+void
+retitle(Client *c) {
+    unsigned int i, j, match, h;
+    unsigned int alive[RULEWORDS];
+    Rule *r;
+
+    retitleruns++;
+    for (i = 0; i < RULEWORDS; i++)
+        alive[i] = rulemask[i] & ~ruleany[FieldTitle][i];
+    matchrules(c, alive);
+    if ((h = hashtitlerules(alive)) == c->titlerules)
+        return;
+    c->titlerules = h;
+    retitlechanges++;
+
+    for (i = 0; i < RULEWORDS; i++) {
+        match = alive[i];
+        for (j = 0; match; j++, match >>= 1) {
+            if (!(match & 1))
+                continue;
+            r = &rules[i * MATCHBITS + j];
+            rulestats[i * MATCHBITS + j].hits++;
+            if (r->tags & TAGMASK)
+                settags(c, c->tags | (r->tags & TAGMASK));
+            c->ignoreborder = r->ignoreborder;
+            if (r->isfloating != c->isfloating) {
+                setfloating(c, r->isfloating);
+                setborder(c, r->isfloating);
+            }
+        }
     }
+    arrange();
 }
 
 void
@@ -921,6 +1813,18 @@ restack(void) {
 
 }
 
+const wchar_t *
+rulefield(const Rule *r, unsigned int field) {
+    switch (field) {
+    case FieldClass:
+        return r->class;
+    case FieldTitle:
+        return r->title;
+    default:
+        return r->processname;
+    }
+}
+
 LRESULT CALLBACK barhandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
     switch (msg) {
@@ -972,6 +1876,17 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             updatebar();
             arrange();
             break;
+        case WM_ARRANGE:
+            flusharrange();
+            break;
+        case WM_TIMER:
+            if (wParam >= RETITLETIMER) {
+                KillTimer(hwnd, wParam);
+                Client *c = slotclient(wParam - RETITLETIMER);
+                if (c->hwnd && getclient(c->hwnd) == c)
+                    retitle(c);
+            }
+            break;
         default:
             if (msg == shellhookid) { /* Handle the shell hook message */
                 Client *c = getclient((HWND)lParam);
@@ -982,6 +1897,9 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                      */
                     case HSHELL_WINDOWCREATED:
                         debug(L"window created: %s\n", getclienttitle((HWND)lParam));
+                        /* sent as the window is shown, look at it afresh */
+                        if (!c)
+                            forgetrejection((HWND)lParam);
                         if (!c && ismanageable((HWND)lParam)) {
                             c = manage((HWND)lParam);
                             managechildwindows(c);
@@ -990,32 +1908,40 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                         break;
                     case HSHELL_WINDOWDESTROYED:
                         if (c) {
-                            debug(L" window %s: %s\n", c->ignore ? L"hidden" : L"destroyed", getclienttitle(c->hwnd));
+                            debug(L" window %s: %s\n", c->ignore ? L"hidden" : L"destroyed", clienttitle(c));
                             if (!c->ignore)
                                 unmanage(c);
                             else
                                 c->ignore = false;
                         } else {
                             debug(L" unmanaged window destroyed\n");
+                            forgetrejection((HWND)lParam);
                         }
                         break;
                     case HSHELL_WINDOWACTIVATED:
-                        debug(L" window activated: %s || %d\n", c ? getclienttitle(c->hwnd) : L"unknown", (HWND)lParam);
+                        debug(L" window activated: %s || %d\n", c ? clienttitle(c) : L"unknown", (HWND)lParam);
                         if (c) {
-                            Client *t = sel;
+                            /* managechildwindows() may unmanage the previously
+                             * selected window if it was one of our children.
+                             */
+                            ClientRef ref = clientref(sel);
+                            Client *t;
                             managechildwindows(c);
                             setselected(c);
+                            t = getclientref(ref);
+                            if (t)
+                                setminimized(t, IsIconic(t->hwnd));
                             /* check if the previously selected 
                              * window got minimized
                              */
-                            if (t && (t->isminimized = IsIconic(t->hwnd))) {
-                                debug(L" active window got minimized: %s\n", getclienttitle(t->hwnd));
+                            if (t && t->isminimized) {
+                                debug(L" active window got minimized: %s\n", clienttitle(t));
                                 arrange();
                             }
                             /* the newly focused window was minimized */
                             if (sel && sel->isminimized) {
-                                debug(L" newly active window was minimized: %s\n", getclienttitle(sel->hwnd));
-                                sel->isminimized = false;                                
+                                debug(L" newly active window was minimized: %s\n", clienttitle(sel));
+                                setminimized(sel, false);
                                 zoom(NULL);
                             }
                         } else  {
@@ -1047,10 +1973,17 @@ wineventproc(HWINEVENTHOOK heventhook, DWORD event, HWND hwnd, LONG object, LONG
 
     Client *c = getclient(hwnd);
 
+    if (!c)
+        forgetrejection(hwnd);
+
     switch (event)
     {
     case EVENT_OBJECT_UNCLOAKED:
-        if (!c && ismanageable(hwnd)) {
+        if (c) {
+            c->iscloaked = false;
+            c->attrs->valid |= 1 << AttrCloaked;
+        }
+        else if (ismanageable(hwnd)) {
             c = manage(hwnd);
             managechildwindows(c);
             setselected(c);
@@ -1060,13 +1993,88 @@ wineventproc(HWINEVENTHOOK heventhook, DWORD event, HWND hwnd, LONG object, LONG
         break;
 
     case EVENT_OBJECT_CLOAKED:
-        if (c)
+        if (c) {
+            c->iscloaked = true;
+            c->attrs->valid |= 1 << AttrCloaked;
             unmanage(c);
+        }
+
+        break;
+
+    case EVENT_OBJECT_NAMECHANGE:
+        if (c) {
+            c->attrs->valid &= ~(1 << AttrTitle);
+            if (c == sel)
+                drawbar();
+            /* restarting the timer on every change debounces per window */
+            if (retitledelay && rulerefs[FieldTitle]) {
+                SetTimer(dwmhwnd, RETITLETIMER + c->slot, retitledelay, NULL);
+                retitleevents++;
+            }
+        }
 
         break;
     }
 }
 
+/* Runs layout l over the tiled clients. Flipping tags or layouts back
+ * and forth recomputes the same geometry over and over, so the results
+ * for the last few distinct arguments are kept and copied out instead. */
+void
+runlayout(const Layout *l, const LayoutParams *p, const LayoutRects *r) {
+    unsigned int i, k, n = geom.n;
+    int *dst[4] = { r->x, r->y, r->w, r->h };
+    LayoutMemo *m, *lru = NULL;
+    int *rects;
+
+    if (l->ref) {
+        /* Lua layouts may look at more than the arguments, never remember them */
+        if (!dwm_layout_run(lua, l->ref, p, n, r, tiledhwnd))
+            l->arrange(p, n, r);
+        debuglayout(l, p, r);
+        return;
+    }
+    if (n == 0) {
+        l->arrange(p, n, r);
+        return;
+    }
+    for (i = 0; i < LENGTH(layoutmemo); i++) {
+        m = &layoutmemo[i];
+        if (m->layout == l && m->n == n
+        && m->p.x == p->x && m->p.y == p->y && m->p.w == p->w && m->p.h == p->h
+        && m->p.mfact == p->mfact && m->p.minh == p->minh) {
+            for (k = 0; k < 4; k++)
+                memcpy(dst[k], m->rects + k * m->size, n * sizeof(int));
+            m->stamp = arranges;
+            memohits++;
+            return;
+        }
+        if (!lru || m->stamp < lru->stamp)
+            lru = m;
+    }
+
+    memomisses++;
+    l->arrange(p, n, r);
+    debuglayout(l, p, r);
+
+    if (lru->size < n) {
+        /* the memo is an optimization only, forget the entry if short on memory */
+        if (!(rects = realloc(lru->rects, 4 * n * sizeof(int)))) {
+            free(lru->rects);
+            memset(lru, 0, sizeof *lru);
+            return;
+        }
+        lru->rects = rects;
+        lru->size = n;
+    }
+    lru->layout = l;
+    lru->p = *p;
+    lru->n = n;
+    lru->stamp = arranges;
+    for (k = 0; k < 4; k++)
+        memcpy(lru->rects + k * lru->size, dst[k], n * sizeof(int));
+}
+
 BOOL CALLBACK 
 scan(HWND hwnd, LPARAM lParam) {
     Client *c = getclient(hwnd);
@@ -1102,6 +2110,14 @@ drawborder(Client *c, COLORREF color) {
 #endif
 }
 
+void
+setbit(unsigned int *bits, unsigned int i, bool on) {
+    if (on)
+        bits[i / 32] |= 1u << (i % 32);
+    else
+        bits[i / 32] &= ~(1u << (i % 32));
+}
+
 void
 setborder(Client *c, bool border) {
     if (!c->ignoreborder) {
@@ -1120,8 +2136,35 @@ setborder(Client *c, bool border) {
     }
 }
 
+void
+setfloating(Client *c, bool isfloating) {
+    c->isfloating = isfloating;
+    setbit(floatbits, c->slot, isfloating);
+    updatetiled(c);
+}
+
+void
+setminimized(Client *c, bool isminimized) {
+    c->isminimized = isminimized;
+    setbit(minbits, c->slot, isminimized);
+    updatetiled(c);
+}
+
+void
+settags(Client *c, unsigned int newtags) {
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(tags); i++)
+        setbit(tagbits[i], c->slot, newtags & 1 << i);
+    counttags(c->tags, -1);
+    counttags(newtags, +1);
+    c->tags = newtags;
+    updatetiled(c);
+}
+
 void
 setvisibility(HWND hwnd, bool visibility) {
+    visibilitychanges++;
     SetWindowPos(hwnd, 0, 0, 0, 0, 0, (visibility ? SWP_SHOWWINDOW : SWP_HIDEWINDOW) | SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE | SWP_NOZORDER);
 }
 
@@ -1151,8 +2194,135 @@ setmfact(const Arg *arg) {
     arrange();
 }
 
+/* dwm.dumprulestats(path) writes the rule statistics as csv */
+static int
+f_dumprulestats(lua_State *L) {
+	const char *path = luaL_checkstring(L, 1);
+	FILE *fout = fopen(path, "w");
+
+	if (!fout)
+		return luaL_error(L, "cannot open %s", path);
+	dumprulestats(fout);
+	fclose(fout);
+	return 0;
+}
+
+static void
+f_pushwstring(lua_State *L, const wchar_t *s) {
+	char *utf8;
+
+	if (!s || !(utf8 = utf16_to_utf8(s))) {
+		lua_pushnil(L);
+		return;
+	}
+	lua_pushstring(L, utf8);
+	free(utf8);
+}
+
+/* returns the layout called symbol, the ones in layouts[] come first */
+static Layout *
+findlayout(const wchar_t *symbol) {
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(layouts); i++)
+		if (!wcscmp(layouts[i].symbol, symbol))
+			return &layouts[i];
+	for (i = 0; i < nlualayouts; i++)
+		if (!wcscmp(lualayouts[i].symbol, symbol))
+			return &lualayouts[i];
+	return NULL;
+}
+
+/* dwm.layout.register(symbol, fn) makes fn(n, area, geometry) arrange the
+ * tiled clients whenever the layout called symbol is selected. A symbol of
+ * a layout in config.h replaces the arrange function of that layout. */
+static int
+f_registerlayout(lua_State *L) {
+	wchar_t *symbol;
+	Layout *l;
+
+	luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+	if (!(symbol = utf8_to_utf16(lua_tostring(L, 1))))
+		return luaL_error(L, "invalid layout symbol");
+	if ((l = findlayout(symbol))) {
+		free(symbol);
+		if (l->ref)
+			luaL_unref(L, LUA_REGISTRYINDEX, l->ref);
+	} else {
+		if (nlualayouts == LENGTH(lualayouts)) {
+			free(symbol);
+			return luaL_error(L, "too many layouts, at most %d can be registered", MAXLUALAYOUTS);
+		}
+		l = &lualayouts[nlualayouts++];
+		l->symbol = symbol;
+	}
+	if (!l->arrange)
+		l->arrange = tile; /* used if fn raises an error */
+	lua_pushvalue(L, 2);
+	l->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	return 0;
+}
+
+/* dwm.layout.set(symbol) selects a layout like the setlayout key binding */
+static int
+f_setlayout(lua_State *L) {
+	wchar_t *symbol;
+	Layout *l;
+	Arg a;
+
+	if (!(symbol = utf8_to_utf16(luaL_checkstring(L, 1))))
+		return luaL_error(L, "invalid layout symbol");
+	l = findlayout(symbol);
+	free(symbol);
+	if (!l)
+		return luaL_error(L, "no layout %s", lua_tostring(L, 1));
+	a.v = l;
+	setlayout(&a);
+	return 0;
+}
+
+/* dwm.rulestats() returns a table per rule, times are in microseconds */
+static int
+f_rulestats(lua_State *L) {
+	unsigned int i, f;
+	double us = perffreq.QuadPart ? 1e6 / perffreq.QuadPart : 0;
+
+	lua_createtable(L, LENGTH(rules), 0);
+	for (i = 0; i < LENGTH(rules); i++) {
+		lua_createtable(L, 0, 6);
+		for (f = 0; f < FieldLast; f++) {
+			f_pushwstring(L, rulefield(&rules[i], f));
+			lua_setfield(L, -2, fieldnames[f]);
+		}
+		lua_pushinteger(L, rulestats[i].hits);
+		lua_setfield(L, -2, "hits");
+		lua_createtable(L, 0, FieldLast);
+		for (f = 0; f < FieldLast; f++) {
+			lua_pushnumber(L, rulestats[i].fetch[f] * us);
+			lua_setfield(L, -2, fieldnames[f]);
+		}
+		lua_setfield(L, -2, "fetch");
+		lua_pushnumber(L, rulestats[i].match * us);
+		lua_setfield(L, -2, "match");
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
 int
 luaopen_dwmlibs(lua_State *L, DwmState* state) {
+	const luaL_Reg dwmlib[] = {
+		{ "rulestats", f_rulestats },
+		{ "dumprulestats", f_dumprulestats },
+		{ NULL, NULL }
+	};
+	const luaL_Reg layoutlib[] = {
+		{ "register", f_registerlayout },
+		{ "set", f_setlayout },
+		{ NULL, NULL }
+	};
+
 	luaL_openlibs(L);
 
 #ifndef LUAJIT
@@ -1160,11 +2330,14 @@ luaopen_dwmlibs(lua_State *L, DwmState* state) {
 #endif
 
 	luaL_requiref(L, "dwm", luaopen_dwm, 0);
+	luaL_setfuncs(L, dwmlib, 0); /* these need the window manager's state */
 	dwm_setstate(L, state);
 	luaL_requiref(L, "dwm.eventemitter", luaopen_dwm_eventemitter, 0);
 	luaL_requiref(L, "dwm.display", luaopen_dwm_display, 0);
 	luaL_requiref(L, "dwm.client", luaopen_dwm_client, 0);
 	luaL_requiref(L, "dwm.hotkey", luaopen_dwm_hotkey, 0);
+	luaL_requiref(L, "dwm.layout", luaopen_dwm_layout, 0);
+	luaL_setfuncs(L, layoutlib, 0);
 
 	return 1;
 }
@@ -1199,13 +2372,27 @@ setup(lua_State *L, HINSTANCE hInstance) {
 	lua_atpanic(L, &lua_panic_handler);
 	DwmState *state = (DwmState*)malloc(sizeof(DwmState));
 	state->hInstance = hInstance;
-	luaopen_dwmlibs(L, state);
-	load_user_script(L);
+	lua = L;
 
     unsigned int i;
 
+    /* before the user script, which may select a layout */
     lt[0] = &layouts[0];
     lt[1] = &layouts[1 % LENGTH(layouts)];
+    for (i = 0; i < LENGTH(pertag); i++) {
+        pertag[i].lt[0] = lt[0];
+        pertag[i].lt[1] = lt[1];
+        pertag[i].sellt = sellt;
+        pertag[i].mfact = mfact;
+    }
+    switchtag(tagset[seltags]);
+
+	luaopen_dwmlibs(L, state);
+	load_user_script(L);
+
+    QueryPerformanceFrequency(&perffreq);
+    compilerules();
+    compileblocklist();
 
     /* init appearance */
 
@@ -1265,10 +2452,12 @@ setup(lua_State *L, HINSTANCE hInstance) {
     /* Grab a dynamic id for the SHELLHOOK message to be used later */
     shellhookid = RegisterWindowMessageW(L"SHELLHOOK");
 
-    wineventhook = SetWinEventHook(EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED, NULL, wineventproc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    for (i = 0; i < LENGTH(winevents); i++) {
+        wineventhooks[i] = SetWinEventHook(winevents[i][0], winevents[i][1], NULL, wineventproc, 0, 0, WINEVENT_OUTOFCONTEXT);
 
-    if (!wineventhook)
-        die(L"Could not SetWinEventHook");
+        if (!wineventhooks[i])
+            die(L"Could not SetWinEventHook");
+    }
 
     updatebar();
 
@@ -1318,6 +2507,10 @@ setupbar(HINSTANCE hInstance) {
          w = TEXTW(layouts[i].symbol);
         blw = MAX(blw, w);
     }
+    for (i = 0; i < nlualayouts; i++) {
+        w = TEXTW(lualayouts[i].symbol);
+        blw = MAX(blw, w);
+    }
 
     ReleaseDC(barhwnd, dc.hdc);
 
@@ -1347,30 +2540,59 @@ showhide(Client *c) {
             c->wasvisible = true;
             setvisibility(c->hwnd, false);
         }
-    } else {
-        if (c->wasvisible) {
-            setvisibility(c->hwnd, true);
-        }
+    } else if (c->wasvisible && !IsWindowVisible(c->hwnd)) {
+        setvisibility(c->hwnd, true);
     }
     showhide(c->snext);
 }
 
+Client *
+slotclient(unsigned int slot) {
+    return &slabs[slot / POOLSLABSIZE]->clients[slot % POOLSLABSIZE];
+}
+
 void
 spawn(const Arg *arg) {
     ShellExecuteW(NULL, NULL, ((wchar_t **)arg->v)[0], ((wchar_t **)arg->v)[1], NULL, SW_SHOWDEFAULT);
 }
 
+/* Keeps the layout, the previous layout and mfact per tag. The state
+ * shown with tagset t belongs to the current tag as long as t contains
+ * it, to the first tag of t otherwise, or to slot 0 if t are all tags. */
+void
+switchtag(unsigned int t) {
+    unsigned int i;
+
+    pertag[curtag].lt[0] = lt[0];
+    pertag[curtag].lt[1] = lt[1];
+    pertag[curtag].sellt = sellt;
+    pertag[curtag].mfact = mfact;
+
+    if (t == TAGMASK)
+        i = 0;
+    else if (curtag && t & 1 << (curtag - 1))
+        i = curtag;
+    else
+        for (i = 1; !(t & 1 << (i - 1)); i++);
+    curtag = i;
+
+    lt[0] = pertag[i].lt[0];
+    lt[1] = pertag[i].lt[1];
+    sellt = pertag[i].sellt;
+    mfact = pertag[i].mfact;
+}
+
 void
 tag(const Arg *arg) {
     Client *c;
 
     if (sel && arg->ui & TAGMASK) {
-        sel->tags = arg->ui & TAGMASK;
-        debug(L"window tagged: %d %s\n", sel->hwnd, getclienttitle(sel->hwnd));
-        for (c = managechildwindows(sel); c; c = nextchild(sel, c->next)) {
-            debug(L" child window which is %s tagged: %s\n", c->isfloating ? L"floating" : L"normal", getclienttitle(c->hwnd));
+        settags(sel, arg->ui & TAGMASK);
+        debug(L"window tagged: %d %s\n", sel->hwnd, clienttitle(sel));
+        for (c = managechildwindows(sel); c; c = c->cnext) {
+            debug(L" child window which is %s tagged: %s\n", c->isfloating ? L"floating" : L"normal", clienttitle(c));
             if (c->isfloating)
-                c->tags = arg->ui & TAGMASK;
+                settags(c, arg->ui & TAGMASK);
         }
         debug(L"window tagged finished\n");
         arrange();
@@ -1387,38 +2609,10 @@ textnw(const wchar_t *text, unsigned int len) {
 }
 
 
-void
-tile(void) {
-    int x, y, h, w, mw;
-    unsigned int i, n;
-    Client *c;
-
-    for (n = 0, c = nexttiled(clients); c; c = nexttiled(c->next), n++);
-    if (n == 0)
-        return;
-
-    /* master */
-    c = nexttiled(clients);
-    mw = mfact * ww;
-    resize(c, wx, wy, (n == 1 ? ww : mw) - 2 * c->bw, wh - 2 * c->bw);
-
-    if (--n == 0)
-        return;
-
-    /* tile stack */
-    x = (wx + mw > c->x + c->w) ? c->x + c->w + 2 * c->bw : wx + mw;
-    y = wy;
-    w = (wx + mw > c->x + c->w) ? wx + ww - x : ww - mw;
-    h = wh / n;
-    if (h < bh)
-        h = wh;
-
-    for (i = 0, c = nexttiled(c->next); c; c = nexttiled(c->next), i++) {
-        resize(c, x, y, w - 2 * c->bw, /* remainder */ ((i + 1 == n)
-               ? wy + wh - y - 2 * c->bw : h - 2 * c->bw));
-        if (h != wh)
-            y = c->y + HEIGHT(c);
-    }
+/* window of tiled client i, for the Lua layouts */
+HWND
+tiledhwnd(unsigned int i) {
+    return geom.c[i]->hwnd;
 }
 
 void
@@ -1456,7 +2650,7 @@ void
 togglefloating(const Arg *arg) {
     if (!sel)
         return;
-    sel->isfloating = !sel->isfloating || sel->isfixed;
+    setfloating(sel, !sel->isfloating || sel->isfixed);
     setborder(sel, sel->isfloating);
     if (sel->isfloating)
         resize(sel, sel->x, sel->y, sel->w, sel->h);
@@ -1472,7 +2666,7 @@ toggletag(const Arg *arg) {
     
     mask = sel->tags ^ (arg->ui & TAGMASK);
     if (mask) {
-        sel->tags = mask;
+        settags(sel, mask);
         arrange();
     }
 }
@@ -1483,6 +2677,8 @@ toggleview(const Arg *arg) {
 
     if (mask) {
         tagset[seltags] = mask;
+        switchtag(mask);
+        rebuildtiled();
         arrange();
     }
 }
@@ -1501,27 +2697,102 @@ writelog(const Arg *arg) {
         fprintf(fout, "%d,", c->parent == NULL ? 0 : c->parent);
         fprintf(fout, "%d,", c->tags);
         fprintf(fout, "%d,", IsWindowVisible(c->hwnd));
-        fwprintf(fout, getclientclassname(c->hwnd));
+        fwprintf(fout, clientclassname(c));
         fprintf(fout, ",");
-        fwprintf(fout, getclienttitle(c->hwnd));
+        fwprintf(fout, clienttitle(c));
         fprintf(fout, "\n");
     }
 
     fclose(fout);
+
+    writestats();
+}
+
+void
+writestats(void) {
+    unsigned int i;
+    FILE *fout;
+    fout = fopen("dwm-win32-stats.log", "w");
+    if (fout == NULL) return;
+
+    fprintf(fout, "pool.slabs=%u\n", nslabs);
+    fprintf(fout, "pool.allocs=%u\n", nclientallocs);
+    fprintf(fout, "pool.frees=%u\n", nclientfrees);
+    for (i = 0; i < AttrLast; i++) {
+        fprintf(fout, "attr.%s.hits=%u\n", attrnames[i], attrhits[i]);
+        fprintf(fout, "attr.%s.misses=%u\n", attrnames[i], attrmisses[i]);
+    }
+    fprintf(fout, "process.hits=%u\n", prochits);
+    fprintf(fout, "process.misses=%u\n", procmisses);
+    fprintf(fout, "process.exits=%u\n", procexits);
+    fprintf(fout, "process.denied=%u\n", procdenied);
+    fprintf(fout, "reject.hits=%u\n", rejecthits);
+    fprintf(fout, "reject.misses=%u\n", rejectmisses);
+    for (i = 0; i < FieldLast; i++)
+        fprintf(fout, "rules.%s.skipped=%u\n", fieldnames[i], fieldskips[i]);
+    fprintf(fout, "retitle.events=%u\n", retitleevents);
+    fprintf(fout, "retitle.runs=%u\n", retitleruns);
+    fprintf(fout, "retitle.changes=%u\n", retitlechanges);
+    fprintf(fout, "arrange.requests=%u\n", arrangerequests);
+    fprintf(fout, "arrange.runs=%u\n", arranges);
+    fprintf(fout, "layout.memo.hits=%u\n", memohits);
+    fprintf(fout, "layout.memo.misses=%u\n", memomisses);
+    fprintf(fout, "window.moves=%u\n", resizemoves);
+    fprintf(fout, "window.unchanged=%u\n", resizeskips);
+    fprintf(fout, "window.showhide=%u\n", visibilitychanges);
+    fprintf(fout, "window.batches=%u\n", batchcommits);
+    fprintf(fout, "window.deferred=%u\n", batchmoves);
+    fprintf(fout, "window.fallbacks=%u\n", batchfallbacks);
+    fclose(fout);
+
+    /* csv, unlike the key=value lines above */
+    fout = fopen("dwm-win32-rules.csv", "w");
+    if (fout == NULL) return;
+    dumprulestats(fout);
+    fclose(fout);
+}
+
+void
+track(Client *c) {
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(tags); i++)
+        setbit(tagbits[i], c->slot, c->tags & 1 << i);
+    setbit(floatbits, c->slot, c->isfloating);
+    setbit(minbits, c->slot, c->isminimized);
+    counttags(c->tags, +1);
+    updatetiled(c);
+}
+
+void
+untrack(Client *c) {
+    unsigned int i;
+
+    for (i = 0; i < LENGTH(tags); i++)
+        setbit(tagbits[i], c->slot, false);
+    setbit(floatbits, c->slot, false);
+    setbit(minbits, c->slot, false);
+    counttags(c->tags, -1);
+    untile(c);
 }
 
 void
 unmanage(Client *c) {
-    debug(L" unmanage %s\n", getclienttitle(c->hwnd));
+    debug(L" unmanage %s\n", clienttitle(c));
     if (c->wasvisible)
         setvisibility(c->hwnd, true);
     if (!c->isfloating)
         setborder(c, true);
+    KillTimer(dwmhwnd, RETITLETIMER + c->slot);
+    unindexclient(c);
+    untrack(c);
+    unlinkchild(c);
+    orphanchildren(c);
     detach(c);
     detachstack(c);
     if (sel == c)
         focus(NULL);
-    free(c);
+    freeclient(c);
     arrange();
 }
 
@@ -1563,6 +2834,56 @@ updategeom(void) {
     debug(L"updategeom: %d x %d\n", ww, wh);
 }
 
+void
+unlinkchild(Client *c) {
+    if (!c->parent)
+        return;
+    if (c->cprev)
+        c->cprev->cnext = c->cnext;
+    else if (c->pclient)
+        c->pclient->children = c->cnext;
+    else
+        orphans = c->cnext;
+    if (c->cnext)
+        c->cnext->cprev = c->cprev;
+    c->cnext = c->cprev = NULL;
+}
+
+void
+untile(Client *c) {
+    unsigned int i;
+
+    if (!c->istiled)
+        return;
+    for (i = 0; geom.c[i] != c; i++);
+    memmove(&geom.c[i], &geom.c[i + 1], (--geom.n - i) * sizeof(Client *));
+    c->istiled = false;
+}
+
+/* (re)inserts c into the tiled vector at its list position */
+void
+updatetiled(Client *c) {
+    unsigned int i, lo, hi;
+
+    untile(c);
+    if (c->isfloating || c->isminimized || !ISVISIBLE(c))
+        return;
+
+    if (geom.n == geom.size)
+        growgeometry(geom.size ? 2 * geom.size : 64);
+    for (lo = 0, hi = geom.n; lo < hi; ) {
+        i = (lo + hi) / 2;
+        if (geom.c[i]->order < c->order)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    memmove(&geom.c[lo + 1], &geom.c[lo], (geom.n - lo) * sizeof(Client *));
+    geom.c[lo] = c;
+    geom.n++;
+    c->istiled = true;
+}
+
 void
 view(const Arg *arg) {
     if ((arg->ui & TAGMASK) == tagset[seltags])
@@ -1570,6 +2891,8 @@ view(const Arg *arg) {
     seltags ^= 1; /* toggle sel tagset */
     if (arg->ui & TAGMASK)
         tagset[seltags] = arg->ui & TAGMASK;
+    switchtag(tagset[seltags]);
+    rebuildtiled();
     arrange();
 }
 
@@ -1579,19 +2902,54 @@ zoom(const Arg *arg) {
 
     if (!lt[sellt]->arrange || lt[sellt]->arrange == monocle || (sel && sel->isfloating))
         return;
-    if (c == nexttiled(clients))
-        if (!c || !(c = nexttiled(c->next)))
+    if (c == (geom.n > 0 ? geom.c[0] : NULL))
+        if (!c || !(c = geom.n > 1 ? geom.c[1] : NULL))
             return;
     detach(c);
     attach(c);
+    updatetiled(c);
     focus(c);
     arrange();
 }
 
+/* Moves c to its geometry, as part of the open transaction if there is
+ * one. If the system can't take more deferred moves the transaction is
+ * gone, the moves collected so far and all following ones are then made
+ * right away. */
+void
+movewindow(Client *c) {
+    unsigned int i;
+    HDWP d;
+
+    if (batching && !batchfailed) {
+        if (!movebatch)
+            movebatch = mover.begin(geom.n);
+        d = movebatch ? mover.defer(movebatch, c->hwnd, HWND_TOP, c->x, c->y, c->w, c->h, SWP_NOACTIVATE) : NULL;
+        if (d) {
+            movebatch = d;
+            c->isdeferred = true;
+            batchmoves++;
+            return;
+        }
+        batchfailed = true;
+        movebatch = NULL;
+        for (i = 0; i < geom.n; i++)
+            if (geom.c[i]->isdeferred) {
+                geom.c[i]->isdeferred = false;
+                mover.move(geom.c[i]->hwnd, HWND_TOP, geom.c[i]->x, geom.c[i]->y, geom.c[i]->w, geom.c[i]->h, SWP_NOACTIVATE);
+                batchfallbacks++;
+            }
+    }
+    mover.move(c->hwnd, HWND_TOP, c->x, c->y, c->w, c->h, SWP_NOACTIVATE);
+}
+
 void
 movestack(const Arg *arg) {
-	Client *c = NULL, *p = NULL, *pc = NULL, *i;
+	Client *c, *p, *pc;
+	uint64_t order;
 
+	if(!sel)
+		return;
 	if(arg->i > 0) {
 		/* find the client after selmon->sel */
 		for(c = sel->next; c && (!ISVISIBLE(c) || c->isfloating); c = c->next);
@@ -1601,37 +2959,35 @@ movestack(const Arg *arg) {
 	}
 	else {
 		/* find the client before sel */
-		for(i = clients; i != sel; i = i->next)
-			if(ISVISIBLE(i) && !i->isfloating)
-				c = i;
+		for(c = sel->prev; c && (!ISVISIBLE(c) || c->isfloating); c = c->prev);
 		if(!c)
-			for(; i; i = i->next)
-				if(ISVISIBLE(i) && !i->isfloating)
-					c = i;
-	}
-	/* find the client before sel and c */
-	for(i = clients; i && (!p || !pc); i = i->next) {
-		if(i->next == sel)
-			p = i;
-		if(i->next == c)
-			pc = i;
+			for(c = lastclient; c && (!ISVISIBLE(c) || c->isfloating); c = c->prev);
 	}
 
 	/* swap c and sel clients in the clients list */
 	if(c && c != sel) {
-		Client *temp = sel->next==c?sel:sel->next;
-		sel->next = c->next==sel?c:c->next;
-		c->next = temp;
-
-		if(p && p != c)
-			p->next = c;
-		if(pc && pc != sel)
-			pc->next = sel;
-
-		if(sel == clients)
-			clients = c;
-		else if(c == clients)
-			clients = sel;
+		if(sel->next == c) {
+			detach(c);
+			attachafter(c, sel->prev);
+		}
+		else if(c->next == sel) {
+			detach(sel);
+			attachafter(sel, c->prev);
+		}
+		else {
+			p = sel->prev;
+			pc = c->prev;
+			detach(sel);
+			detach(c);
+			attachafter(sel, pc);
+			attachafter(c, p);
+		}
+
+		order = sel->order;
+		sel->order = c->order;
+		c->order = order;
+		updatetiled(sel);
+		updatetiled(c);
 
 		arrange();
 	}
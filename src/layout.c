@@ -0,0 +1,309 @@
+/* The built-in layouts. Each one computes the outer geometry of n tiled
+ * clients inside the work area described by p, see layout.h.
+ *
+ * All arithmetic is done in integers. Whenever a length is cut into
+ * cells the pixels left over are handed out one each to the first cells,
+ * so the cells always add up to the length, no gaps and no overlaps. */
+
+#include <stddef.h>
+
+#include "layout.h"
+
+static int cellpos(int start, int len, int n, int i);
+static int cellsize(int len, int n, int i);
+static void fibonacci(const LayoutParams *p, unsigned int n, const LayoutRects *r, int s);
+static int master(int len, int mfact);
+static void split(int start, int len, int n, int *pos, int *size);
+
+void
+bstack(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	int mh;
+	unsigned int i;
+
+	if(n == 0)
+		return;
+
+	mh = master(p->h, p->mfact);
+	r->x[0] = p->x;
+	r->y[0] = p->y;
+	r->w[0] = p->w;
+	r->h[0] = n == 1 ? p->h : mh;
+
+	if(--n == 0)
+		return;
+
+	/* tile stack, cells too small to be useful are piled up instead */
+	if(p->w / (int)n < p->minh)
+		for(i = 1; i <= n; i++) {
+			r->x[i] = p->x;
+			r->w[i] = p->w;
+		}
+	else
+		split(p->x, p->w, n, r->x + 1, r->w + 1);
+	for(i = 1; i <= n; i++) {
+		r->y[i] = p->y + mh;
+		r->h[i] = p->h - mh;
+	}
+}
+
+/* start of cell i when cutting len pixels from start into n cells */
+static int
+cellpos(int start, int len, int n, int i) {
+	return start + i * (len / n) + (i < len % n ? i : len % n);
+}
+
+/* length of cell i when cutting len pixels into n cells */
+static int
+cellsize(int len, int n, int i) {
+	return len / n + (i < len % n);
+}
+
+/* Checks the invariants every layout keeps: no rect leaves the work area
+ * and rects either are the same, clients piled up, or don't overlap at
+ * all. If cover is set the rects also have to cover the whole work area.
+ * Returns what is wrong and sets *bad to the offending rect, or returns
+ * NULL. This is quadratic in n and meant for debug builds. */
+const char *
+checklayout(const LayoutParams *p, unsigned int n, const LayoutRects *r, int cover, unsigned int *bad) {
+	unsigned int i, j;
+	long long area = 0;
+
+	for(i = 0; i < n; i++) {
+		*bad = i;
+		if(r->w[i] < 0 || r->h[i] < 0)
+			return "negative size";
+		if(r->x[i] < p->x || r->y[i] < p->y
+		|| r->x[i] + r->w[i] > p->x + p->w || r->y[i] + r->h[i] > p->y + p->h)
+			return "outside of the work area";
+		for(j = 0; j < i; j++) {
+			if(r->x[j] == r->x[i] && r->y[j] == r->y[i]
+			&& r->w[j] == r->w[i] && r->h[j] == r->h[i])
+				break;
+			if(r->x[j] < r->x[i] + r->w[i] && r->x[i] < r->x[j] + r->w[j]
+			&& r->y[j] < r->y[i] + r->h[i] && r->y[i] < r->y[j] + r->h[j])
+				return "overlapping";
+		}
+		if(j == i)
+			area += (long long)r->w[i] * r->h[i];
+	}
+	*bad = n;
+	if(cover && n > 0 && area != (long long)p->w * p->h)
+		return "not covering the work area";
+	return NULL;
+}
+
+void
+dwindle(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	fibonacci(p, n, r, 1);
+}
+
+/* Every window but the last takes half of the area left, the other half
+ * is what remains for the next ones. rw and rh track the size of that
+ * remaining half, which gets the odd pixel. */
+static void
+fibonacci(const LayoutParams *p, unsigned int n, const LayoutRects *r, int s) {
+	unsigned int i, j;
+	int nx, ny, nw, nh, rw, rh, last, done = 0;
+
+	if(n == 0)
+		return;
+
+	nx = p->x;
+	ny = p->y;
+	nw = rw = p->w;
+	nh = rh = p->h;
+
+	for(i = 0, j = 0; j < n; j++) {
+		if(!done) {
+			/* the last window and any window which can't be halved anymore
+			 * take all that is left */
+			last = j == n - 1 || (i % 2 ? nh / 2 == 0 : nw / 2 == 0);
+			if(!last) {
+				if(i % 2) {
+					rh = nh - nh / 2;
+					nh /= 2;
+				}
+				else {
+					rw = nw - nw / 2;
+					nw /= 2;
+				}
+				if((i % 4) == 2 && !s)
+					nx += rw;
+				else if((i % 4) == 3 && !s)
+					ny += rh;
+			}
+			if((i % 4) == 0) {
+				if(s) {
+					ny += nh;
+					nh = rh;
+				}
+				else {
+					nh = rh;
+					ny -= nh;
+				}
+			}
+			else if((i % 4) == 1) {
+				nx += nw;
+				nw = rw;
+			}
+			else if((i % 4) == 2) {
+				ny += nh;
+				nh = rh;
+			}
+			else if((i % 4) == 3) {
+				if(s) {
+					nx += nw;
+					nw = rw;
+				}
+				else {
+					nw = rw;
+					nx -= nw;
+				}
+			}
+			if(i == 0)
+			{
+				if(!last) {
+					nw = master(p->w, p->mfact);
+					rw = p->w - nw;
+				}
+				ny = p->y;
+			}
+			i++;
+			done = last;
+		}
+		r->x[j] = nx;
+		r->y[j] = ny;
+		r->w[j] = nw;
+		r->h[j] = nh;
+	}
+}
+
+void
+gaplessgrid(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	unsigned int cols, rows, cn, rn, i;
+
+	if(n == 0)
+		return;
+
+	/* grid dimensions */
+	for(cols = 0; cols <= n/2; cols++)
+		if(cols*cols >= n)
+			break;
+	if(n == 5)		/* set layout against the general calculation: not 1:2:2, but 2:3 */
+		cols = 2;
+	rows = n/cols;
+
+	/* window geometries (cell height/width/x/y) */
+	cn = 0; 			/* current column number */
+	rn = 0; 			/* current row number */
+	for(i = 0; i < n; i++) {
+		if(i/rows+1 > cols-n%cols)
+			rows = n/cols+1;
+		r->x[i] = cellpos(p->x, p->w, cols, cn);
+		r->y[i] = cellpos(p->y, p->h, rows, rn);
+		r->w[i] = cellsize(p->w, cols, cn);
+		r->h[i] = cellsize(p->h, rows, rn);
+
+		rn++;
+		if(rn >= rows) { 	/* jump to the next column */
+			rn = 0;
+			cn++;
+		}
+	}
+}
+
+void
+grid(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	unsigned int i, j, cols, rows;
+	int x, w;
+
+	if(n == 0)
+		return;
+
+	/* grid dimensions */
+	for(rows = 0; rows <= n/2; rows++)
+		if(rows*rows >= n)
+			break;
+	cols = (rows && (rows - 1) * rows >= n) ? rows - 1 : rows;
+
+	/* clients fill the grid column by column, the first column holds the
+	 * rows, every other column repeats them */
+	split(p->y, p->h, rows, r->y, r->h);
+	for(i = 0; i < cols; i++) {
+		x = cellpos(p->x, p->w, cols, i);
+		w = cellsize(p->w, cols, i);
+		for(j = i * rows; j < n && j < (i + 1) * rows; j++) {
+			r->x[j] = x;
+			r->y[j] = r->y[j - i * rows];
+			r->w[j] = w;
+			r->h[j] = r->h[j - i * rows];
+		}
+	}
+}
+
+/* width of the master area, len scaled by the fixed point factor mfact */
+static int
+master(int len, int mfact) {
+	return (long long)len * mfact >> MFACTBITS;
+}
+
+void
+monocle(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	unsigned int i;
+
+	for(i = 0; i < n; i++) {
+		r->x[i] = p->x;
+		r->y[i] = p->y;
+		r->w[i] = p->w;
+		r->h[i] = p->h;
+	}
+}
+
+void
+spiral(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	fibonacci(p, n, r, 0);
+}
+
+/* Cuts len pixels from start into n cells, the batch form of cellpos()
+ * and cellsize(). The loop carries no dependency and vectorizes. */
+static void
+split(int start, int len, int n, int *pos, int *size) {
+	int i, q = len / n, rem = len % n;
+
+	for(i = 0; i < n; i++) {
+		pos[i] = start + i * q + (i < rem ? i : rem);
+		size[i] = q + (i < rem);
+	}
+}
+
+void
+tile(const LayoutParams *p, unsigned int n, const LayoutRects *r) {
+	int mw;
+	unsigned int i;
+
+	if(n == 0)
+		return;
+
+	/* master */
+	mw = master(p->w, p->mfact);
+	r->x[0] = p->x;
+	r->y[0] = p->y;
+	r->w[0] = n == 1 ? p->w : mw;
+	r->h[0] = p->h;
+
+	if(--n == 0)
+		return;
+
+	/* tile stack, cells too small to be useful are piled up instead */
+	if(p->h / (int)n < p->minh)
+		for(i = 1; i <= n; i++) {
+			r->y[i] = p->y;
+			r->h[i] = p->h;
+		}
+	else
+		split(p->y, p->h, n, r->y + 1, r->h + 1);
+	for(i = 1; i <= n; i++) {
+		r->x[i] = p->x + mw;
+		r->w[i] = p->w - mw;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef DWM_LAYOUT
+#define DWM_LAYOUT
+
+#define MFACTBITS 16            /* fraction bits of LayoutParams.mfact */
+
+/* A layout is a pure function of the work area, the layout parameters and
+ * the number of tiled clients. It fills in one rect per client, the window
+ * manager then moves the clients there. Nothing in here depends on the
+ * windowing system. */
+typedef struct {
+	int x, y, w, h;         /* work area */
+	int mfact;              /* factor of master area size, fixed point */
+	int minh;               /* stack cells smaller than this overlap instead */
+} LayoutParams;
+
+typedef struct {
+	int *x, *y, *w, *h;     /* outer geometry, n entries each */
+} LayoutRects;
+
+typedef void (*LayoutFunc)(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+
+const char *checklayout(const LayoutParams *p, unsigned int n, const LayoutRects *r, int cover, unsigned int *bad);
+
+void bstack(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void dwindle(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void gaplessgrid(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void grid(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void monocle(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void spiral(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+void tile(const LayoutParams *p, unsigned int n, const LayoutRects *r);
+
+#endif
@@ -0,0 +1,1001 @@
+/* Multi-pattern substring matching, an Aho-Corasick automaton over wchar_t.
+ *
+ * Patterns are added into a trie, matchcompile() then computes the failure
+ * links breadth first and packs each state's transitions into a sorted
+ * slice so that a step is a binary search. The start state, where most
+ * characters of a text leave the automaton, has a table for ASCII instead.
+ * Scanning a text visits every character once, no matter how many
+ * patterns there are.
+ *
+ * Exact keys go into an open addressing table instead, a lookup hashes
+ * the key once and usually compares a single entry. Globs and regular
+ * expressions are compiled into one DFA each, see addpattern(). */
+#include "match.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wctype.h>
+
+#define NONE ((unsigned int)-1)
+#define MAXDFASTATES 1024 /* patterns needing more states are rejected */
+
+typedef struct {
+	wchar_t c;
+	unsigned int from, to;
+	unsigned int next; /* sibling while building the trie */
+} Edge;
+
+typedef struct {
+	unsigned int edges, nedges; /* slice of Matcher.edges, sorted by c once compiled */
+	unsigned int fail;          /* state of the longest proper suffix */
+	unsigned int dict;          /* nearest suffix state with ids, 0 if none */
+	unsigned int ids, nids;     /* slice of Matcher.ids */
+} State;
+
+typedef struct {
+	unsigned int state, id;
+} Out;
+
+typedef struct {
+	const wchar_t *key;
+	unsigned int id;
+} Key;
+
+typedef struct {
+	const wchar_t *key;     /* NULL if the slot is free */
+	unsigned int hash;
+	unsigned int ids, nids; /* slice of Matcher.exactids */
+} Slot;
+
+struct Dfa;
+
+struct Matcher {
+	State *states;
+	unsigned int nstates, sstates;
+	Edge *edges;
+	unsigned int nedges, sedges;
+	Out *outs;
+	unsigned int nouts, souts;
+	unsigned int *ids;
+	Key *keys;
+	unsigned int nkeys, skeys;
+	Slot *table;
+	unsigned int tablesize;
+	unsigned int *exactids;
+	struct Dfa **dfas;
+	unsigned int ndfas, sdfas;
+	unsigned int flags;
+	bool compiled;
+	unsigned int root[128]; /* transitions of the start state on ASCII, see step() */
+};
+
+/* sort order of Matcher.keys while compiling, see cmpkey() */
+static unsigned int sortflags;
+
+static bool
+grow(void **p, unsigned int *size, unsigned int n, size_t elem) {
+	unsigned int size2;
+	void *p2;
+
+	if (n < *size)
+		return true;
+	for (size2 = *size ? *size * 2 : 16; size2 <= n; size2 *= 2);
+	if (!(p2 = realloc(*p, size2 * elem)))
+		return false;
+	*p = p2;
+	*size = size2;
+	return true;
+}
+
+static int
+cmpedge(const void *a, const void *b) {
+	const Edge *x = a, *y = b;
+
+	if (x->from != y->from)
+		return x->from < y->from ? -1 : 1;
+	return x->c < y->c ? -1 : x->c > y->c;
+}
+
+static int
+cmpout(const void *a, const void *b) {
+	const Out *x = a, *y = b;
+
+	if (x->state != y->state)
+		return x->state < y->state ? -1 : 1;
+	return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static int
+keycmp(const wchar_t *a, const wchar_t *b, unsigned int flags) {
+	wint_t x, y;
+
+	for (;; a++, b++) {
+		x = flags & MatchFoldCase ? towlower(*a) : (wint_t)*a;
+		y = flags & MatchFoldCase ? towlower(*b) : (wint_t)*b;
+		if (x != y)
+			return x < y ? -1 : 1;
+		if (!x)
+			return 0;
+	}
+}
+
+static int
+cmpkey(const void *a, const void *b) {
+	const Key *x = a, *y = b;
+	int r = keycmp(x->key, y->key, sortflags);
+
+	return r ? r : x->id < y->id ? -1 : x->id > y->id;
+}
+
+/* FNV-1a */
+static unsigned int
+hashkey(const wchar_t *key, unsigned int flags) {
+	unsigned int h = 2166136261u;
+
+	for (; *key; key++) {
+		h ^= flags & MatchFoldCase ? towlower(*key) : (wint_t)*key;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static unsigned int
+newstate(Matcher *m) {
+	State *s;
+
+	if (!grow((void **)&m->states, &m->sstates, m->nstates, sizeof(State)))
+		return NONE;
+	s = &m->states[m->nstates];
+	s->edges = NONE;
+	s->nedges = s->fail = s->dict = s->ids = s->nids = 0;
+	return m->nstates++;
+}
+
+/* transition of a compiled automaton */
+static unsigned int
+step(const Matcher *m, unsigned int s, wchar_t c) {
+	const Edge *e = m->edges + m->states[s].edges;
+	unsigned int lo = 0, hi = m->states[s].nedges, mid;
+
+	if (!s && (unsigned int)c < 128)
+		return m->root[c];
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (e[mid].c == c)
+			return e[mid].to;
+		if (e[mid].c < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NONE;
+}
+
+Matcher *
+matchnew(unsigned int flags) {
+	Matcher *m = calloc(1, sizeof(Matcher));
+
+	if (m && newstate(m) == NONE) {
+		free(m);
+		return NULL;
+	}
+	if (m)
+		m->flags = flags;
+	return m;
+}
+
+bool
+matchadd(Matcher *m, const wchar_t *pattern, unsigned int id) {
+	unsigned int s = 0, e;
+
+	if (m->compiled)
+		return false;
+	for (; *pattern; pattern++) {
+		for (e = m->states[s].edges; e != NONE && m->edges[e].c != *pattern; e = m->edges[e].next);
+		if (e != NONE) {
+			s = m->edges[e].to;
+			continue;
+		}
+		if (!grow((void **)&m->edges, &m->sedges, m->nedges, sizeof(Edge)))
+			return false;
+		e = m->nedges;
+		m->edges[e].c = *pattern;
+		m->edges[e].from = s;
+		if ((m->edges[e].to = newstate(m)) == NONE)
+			return false;
+		m->edges[e].next = m->states[s].edges;
+		m->states[s].edges = e;
+		m->nedges++;
+		s = m->edges[e].to;
+	}
+	if (!grow((void **)&m->outs, &m->souts, m->nouts, sizeof(Out)))
+		return false;
+	m->outs[m->nouts].state = s;
+	m->outs[m->nouts].id = id;
+	m->nouts++;
+	return true;
+}
+
+bool
+matchaddexact(Matcher *m, const wchar_t *key, unsigned int id) {
+	if (m->compiled || !grow((void **)&m->keys, &m->skeys, m->nkeys, sizeof(Key)))
+		return false;
+	m->keys[m->nkeys].key = key;
+	m->keys[m->nkeys].id = id;
+	m->nkeys++;
+	return true;
+}
+
+/* groups equal keys and spreads them over a table at most half full */
+static bool
+compileexact(Matcher *m) {
+	unsigned int i, j, h, n = 0;
+	Slot *slot;
+
+	if (!m->nkeys)
+		return true;
+	sortflags = m->flags;
+	qsort(m->keys, m->nkeys, sizeof(Key), cmpkey);
+	for (i = 0; i < m->nkeys; i++)
+		if (!i || keycmp(m->keys[i - 1].key, m->keys[i].key, m->flags))
+			n++;
+	for (m->tablesize = 16; m->tablesize < 2 * n; m->tablesize *= 2);
+	if (!(m->table = calloc(m->tablesize, sizeof(Slot)))
+	|| !(m->exactids = malloc(m->nkeys * sizeof(unsigned int))))
+		return false;
+	for (i = 0; i < m->nkeys; i = j) {
+		h = hashkey(m->keys[i].key, m->flags);
+		for (slot = &m->table[h & (m->tablesize - 1)]; slot->key;)
+			slot = slot + 1 < m->table + m->tablesize ? slot + 1 : m->table;
+		slot->key = m->keys[i].key;
+		slot->hash = h;
+		slot->ids = i;
+		for (j = i; j < m->nkeys && !keycmp(m->keys[i].key, m->keys[j].key, m->flags); j++)
+			m->exactids[j] = m->keys[j].id;
+		slot->nids = j - i;
+	}
+	free(m->keys);
+	m->keys = NULL;
+	m->nkeys = m->skeys = 0;
+	return true;
+}
+
+bool
+matchcompile(Matcher *m) {
+	unsigned int *queue, head = 0, tail = 0, i, s, t, f, g;
+	State *st;
+
+	if (m->compiled)
+		return true;
+	if (!compileexact(m))
+		return false;
+
+	/* pack transitions and ids into per state slices */
+	if (m->nedges)
+		qsort(m->edges, m->nedges, sizeof(Edge), cmpedge);
+	for (i = 0; i < m->nstates; i++)
+		m->states[i].edges = 0;
+	for (i = m->nedges; i-- > 0;) {
+		m->states[m->edges[i].from].edges = i;
+		m->states[m->edges[i].from].nedges++;
+	}
+	for (i = 0; i < 128; i++)
+		m->root[i] = NONE;
+	for (i = 0; i < m->nedges && !m->edges[i].from; i++)
+		if ((unsigned int)m->edges[i].c < 128)
+			m->root[m->edges[i].c] = m->edges[i].to;
+	if (m->nouts)
+		qsort(m->outs, m->nouts, sizeof(Out), cmpout);
+	if (!(m->ids = malloc((m->nouts ? m->nouts : 1) * sizeof(unsigned int))))
+		return false;
+	for (i = m->nouts; i-- > 0;) {
+		m->ids[i] = m->outs[i].id;
+		m->states[m->outs[i].state].ids = i;
+		m->states[m->outs[i].state].nids++;
+	}
+	free(m->outs);
+	m->outs = NULL;
+	m->nouts = m->souts = 0;
+
+	/* failure and dictionary links, breadth first so that the links of
+	 * shorter prefixes are known */
+	if (!(queue = malloc(m->nstates * sizeof(unsigned int))))
+		return false;
+	st = m->states;
+	queue[tail++] = 0;
+	while (head < tail) {
+		s = queue[head++];
+		for (i = st[s].edges; i < st[s].edges + st[s].nedges; i++) {
+			t = m->edges[i].to;
+			if (s == 0) {
+				st[t].fail = 0;
+			} else {
+				for (f = st[s].fail; (g = step(m, f, m->edges[i].c)) == NONE && f; f = st[f].fail);
+				st[t].fail = g == NONE ? 0 : g;
+			}
+			f = st[t].fail;
+			st[t].dict = f && st[f].nids ? f : st[f].dict;
+			queue[tail++] = t;
+		}
+	}
+	free(queue);
+	m->compiled = true;
+	return true;
+}
+
+/* Glob and regex patterns, each compiled into its own DFA.
+ *
+ * The pattern is parsed into a Thompson NFA, the characters it tells
+ * apart are split into classes and the subset construction turns the NFA
+ * into a transition table over those classes. Matching is then one table
+ * lookup per character, there is no backtracking. */
+
+enum { NEps, NSplit, NChar, NMatch, NBol, NEol }; /* NFA node types, NBol is ^ and NEol $ */
+enum { AtStart = 1, AtEnd = 2 };                   /* anchors nfaclose() may pass */
+enum { AcceptNow = 1, AcceptAtEnd = 2 };           /* Dfa.accept flags */
+
+typedef struct {
+	wchar_t lo, hi;
+} Range;
+
+typedef struct {
+	unsigned int type;
+	unsigned int out, out1;       /* out1 only for NSplit */
+	unsigned int ranges, nranges; /* NChar, slice of Nfa.ranges */
+} Node;
+
+typedef struct {
+	unsigned int start, end; /* end is an NEps, NChar, NBol or NEol with a dangling out */
+} Frag;
+
+typedef struct {
+	Node *nodes;
+	unsigned int nnodes, snodes;
+	Range *ranges;
+	unsigned int nranges, sranges;
+	const wchar_t *p, *end; /* parse position */
+	unsigned int flags;
+	bool error;
+} Nfa;
+
+struct Dfa {
+	unsigned int id;
+	bool whole;       /* matched against whole keys by matchexact() */
+	bool acceptempty; /* the empty text matches */
+	unsigned int flags;
+	wchar_t *bounds;  /* first character of each class */
+	unsigned int nclasses;
+	unsigned char ascii[128]; /* class of characters below 128 */
+	unsigned int *next;       /* nstates * nclasses transitions */
+	unsigned char *accept;    /* Accept* flags of every state */
+	unsigned int nstates, dead;
+};
+
+static unsigned int
+nfanode(Nfa *n, unsigned int type) {
+	Node *x;
+
+	if (!grow((void **)&n->nodes, &n->snodes, n->nnodes, sizeof(Node))) {
+		n->error = true;
+		return 0;
+	}
+	x = &n->nodes[n->nnodes];
+	x->type = type;
+	x->out = x->out1 = NONE;
+	x->ranges = n->nranges;
+	x->nranges = 0;
+	return n->nnodes++;
+}
+
+static void
+nfarange(Nfa *n, wchar_t lo, wchar_t hi) {
+	if (!grow((void **)&n->ranges, &n->sranges, n->nranges, sizeof(Range))) {
+		n->error = true;
+		return;
+	}
+	n->ranges[n->nranges].lo = lo;
+	n->ranges[n->nranges].hi = hi;
+	n->nranges++;
+}
+
+static int
+cmprange(const void *a, const void *b) {
+	const Range *x = a, *y = b;
+
+	return x->lo < y->lo ? -1 : x->lo > y->lo;
+}
+
+/* adds lo-hi to the ranges of the last node, folded if needed */
+static void
+nfaaddrange(Nfa *n, wchar_t lo, wchar_t hi) {
+	wchar_t c;
+
+	nfarange(n, lo, hi);
+	if (!(n->flags & MatchFoldCase))
+		return;
+	if (hi - lo <= 0x100)
+		for (c = lo; ; c++) {
+			if ((wchar_t)towlower(c) != c)
+				nfarange(n, towlower(c), towlower(c));
+			if (c == hi)
+				break;
+		}
+	else if (towlower(lo) <= towlower(hi))
+		nfarange(n, towlower(lo), towlower(hi));
+}
+
+/* complements the ranges of node x over all characters */
+static void
+nfanegate(Nfa *n, unsigned int x) {
+	Range r;
+	unsigned int i, nr, first = n->nranges;
+	wchar_t lo = 0;
+	bool full = false;
+
+	nr = n->nodes[x].nranges;
+	qsort(n->ranges + n->nodes[x].ranges, nr, sizeof(Range), cmprange);
+	for (i = 0; i < nr && !full; i++) {
+		r = n->ranges[n->nodes[x].ranges + i]; /* nfarange() may move them */
+		if (r.lo > lo)
+			nfarange(n, lo, r.lo - 1);
+		if (r.hi == WCHAR_MAX)
+			full = true;
+		else if (r.hi >= lo)
+			lo = r.hi + 1;
+	}
+	if (!full)
+		nfarange(n, lo, WCHAR_MAX);
+	n->nodes[x].ranges = first;
+	n->nodes[x].nranges = n->nranges - first;
+}
+
+static Frag
+nfachar(Nfa *n, wchar_t lo, wchar_t hi) {
+	Frag f;
+
+	f.start = f.end = nfanode(n, NChar);
+	nfaaddrange(n, lo, hi);
+	n->nodes[f.start].nranges = n->nranges - n->nodes[f.start].ranges;
+	return f;
+}
+
+static void
+nfapatch(Nfa *n, unsigned int end, unsigned int to) {
+	n->nodes[end].out = to;
+}
+
+static Frag
+nfastar(Nfa *n, Frag a) {
+	Frag f;
+
+	f.start = nfanode(n, NSplit);
+	f.end = nfanode(n, NEps);
+	n->nodes[f.start].out = a.start;
+	n->nodes[f.start].out1 = f.end;
+	nfapatch(n, a.end, f.start);
+	return f;
+}
+
+/* [...] after the opening bracket, negate is the negation character */
+static Frag
+nfaclass(Nfa *n, wchar_t negate) {
+	Frag f;
+	bool neg = false;
+	wchar_t lo, hi;
+
+	f.start = f.end = nfanode(n, NChar);
+	if (n->p < n->end && *n->p == negate) {
+		neg = true;
+		n->p++;
+	}
+	/* a leading ] is literal */
+	do {
+		if (n->p >= n->end) {
+			n->error = true;
+			return f;
+		}
+		lo = hi = *n->p++;
+		if (n->p + 1 < n->end && *n->p == L'-' && n->p[1] != L']') {
+			hi = n->p[1];
+			n->p += 2;
+		}
+		if (lo > hi) {
+			n->error = true;
+			return f;
+		}
+		nfaaddrange(n, lo, hi);
+	} while (n->p >= n->end || *n->p != L']');
+	n->p++;
+	n->nodes[f.start].nranges = n->nranges - n->nodes[f.start].ranges;
+	if (neg)
+		nfanegate(n, f.start);
+	return f;
+}
+
+static Frag nfaalt(Nfa *n);
+
+static Frag
+nfaatom(Nfa *n) {
+	Frag f;
+	wchar_t c = *n->p++;
+
+	switch (c) {
+	case L'(':
+		f = nfaalt(n);
+		if (n->p >= n->end || *n->p != L')')
+			n->error = true;
+		n->p++;
+		return f;
+	case L'[':
+		return nfaclass(n, L'^');
+	case L'.':
+		return nfachar(n, 0, WCHAR_MAX);
+	case L'\\':
+		if (n->p >= n->end)
+			break;
+		switch (c = *n->p++) {
+		case L'd':
+			return nfachar(n, L'0', L'9');
+		case L's':
+			f = nfachar(n, L' ', L' ');
+			nfaaddrange(n, L'\t', L'\r');
+			n->nodes[f.start].nranges = n->nranges - n->nodes[f.start].ranges;
+			return f;
+		case L'w':
+			f = nfachar(n, L'0', L'9');
+			nfaaddrange(n, L'A', L'Z');
+			nfaaddrange(n, L'a', L'z');
+			nfaaddrange(n, L'_', L'_');
+			n->nodes[f.start].nranges = n->nranges - n->nodes[f.start].ranges;
+			return f;
+		case L't':
+			return nfachar(n, L'\t', L'\t');
+		case L'n':
+			return nfachar(n, L'\n', L'\n');
+		default:
+			if (iswalnum(c))
+				break; /* unsupported escape */
+			return nfachar(n, c, c);
+		}
+		break;
+	case L'^':
+		f.start = f.end = nfanode(n, NBol);
+		return f;
+	case L'$':
+		f.start = f.end = nfanode(n, NEol);
+		return f;
+	case L'*': case L'+': case L'?': case L'{': case L')':
+		break;
+	default:
+		return nfachar(n, c, c);
+	}
+	n->error = true;
+	f.start = f.end = 0;
+	return f;
+}
+
+static Frag
+nfarepeat(Nfa *n) {
+	Frag a = nfaatom(n), f;
+
+	while (!n->error && n->p < n->end && wcschr(L"*+?", *n->p)) {
+		switch (*n->p++) {
+		case L'*':
+			a = nfastar(n, a);
+			break;
+		case L'+':
+			f = nfastar(n, a);
+			a.end = f.end;
+			break;
+		case L'?':
+			f.start = nfanode(n, NSplit);
+			f.end = nfanode(n, NEps);
+			n->nodes[f.start].out = a.start;
+			n->nodes[f.start].out1 = f.end;
+			nfapatch(n, a.end, f.end);
+			a = f;
+			break;
+		}
+	}
+	return a;
+}
+
+static Frag
+nfaconcat(Nfa *n) {
+	Frag f, g;
+
+	f.start = f.end = nfanode(n, NEps);
+	while (!n->error && n->p < n->end && *n->p != L'|' && *n->p != L')') {
+		g = nfarepeat(n);
+		nfapatch(n, f.end, g.start);
+		f.end = g.end;
+	}
+	return f;
+}
+
+static Frag
+nfaalt(Nfa *n) {
+	Frag a = nfaconcat(n), b, f;
+
+	while (!n->error && n->p < n->end && *n->p == L'|') {
+		n->p++;
+		b = nfaconcat(n);
+		f.start = nfanode(n, NSplit);
+		f.end = nfanode(n, NEps);
+		n->nodes[f.start].out = a.start;
+		n->nodes[f.start].out1 = b.start;
+		nfapatch(n, a.end, f.end);
+		nfapatch(n, b.end, f.end);
+		a = f;
+	}
+	return a;
+}
+
+/* * is any run, ? any character and [...] a class, [!...] negated. Globs
+ * match whole keys, so the pattern is put between ^ and $. */
+static Frag
+nfaglob(Nfa *n) {
+	Frag f, g;
+	wchar_t c;
+
+	f.start = f.end = nfanode(n, NBol);
+	while (!n->error && n->p < n->end) {
+		switch (c = *n->p++) {
+		case L'*':
+			g = nfastar(n, nfachar(n, 0, WCHAR_MAX));
+			break;
+		case L'?':
+			g = nfachar(n, 0, WCHAR_MAX);
+			break;
+		case L'[':
+			g = nfaclass(n, L'!');
+			break;
+		default:
+			g = nfachar(n, c, c);
+			break;
+		}
+		nfapatch(n, f.end, g.start);
+		f.end = g.end;
+	}
+	g.start = g.end = nfanode(n, NEol);
+	nfapatch(n, f.end, g.start);
+	f.end = g.end;
+	return f;
+}
+
+/* Adds the epsilon closure of x to set, passing the anchors in at. Only
+ * NChar, NMatch and the NEol nodes which could not be passed are kept. */
+static void
+nfaclose(const Nfa *n, unsigned int x, unsigned int at, unsigned int *set, unsigned int *stack, unsigned int *seen, unsigned int stamp) {
+	unsigned int sp = 0;
+	const Node *y;
+
+	stack[sp++] = x;
+	while (sp) {
+		x = stack[--sp];
+		if (x == NONE || seen[x] == stamp)
+			continue;
+		seen[x] = stamp;
+		y = &n->nodes[x];
+		switch (y->type) {
+		case NSplit:
+			stack[sp++] = y->out1;
+			/* fallthrough */
+		case NEps:
+			stack[sp++] = y->out;
+			break;
+		case NBol:
+			if (at & AtStart)
+				stack[sp++] = y->out;
+			break;
+		case NEol:
+			if (at & AtEnd)
+				stack[sp++] = y->out;
+			else
+				MATCHSET(set, x);
+			break;
+		default:
+			MATCHSET(set, x);
+			break;
+		}
+	}
+}
+
+/* whether set holds the NMatch node */
+static bool
+nfaaccepts(const Nfa *n, const unsigned int *set) {
+	unsigned int x;
+
+	for (x = 0; x < n->nnodes; x++)
+		if (MATCHISSET(set, x) && n->nodes[x].type == NMatch)
+			return true;
+	return false;
+}
+
+static bool
+nfahas(const Nfa *n, const Node *x, wchar_t c) {
+	const Range *r = n->ranges + x->ranges;
+	unsigned int i;
+
+	for (i = 0; i < x->nranges; i++)
+		if (r[i].lo <= c && c <= r[i].hi)
+			return true;
+	return false;
+}
+
+static int
+cmpwchar(const void *a, const void *b) {
+	wchar_t x = *(const wchar_t *)a, y = *(const wchar_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* last class whose first character is <= c */
+static unsigned int
+boundclass(const wchar_t *bounds, unsigned int n, wchar_t c) {
+	unsigned int lo = 0, hi = n, mid;
+
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		if (bounds[mid] <= c)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* splits the alphabet at every range boundary of the NFA */
+static bool
+dfaclasses(struct Dfa *d, const Nfa *n) {
+	unsigned int i, j = 0;
+	wchar_t *b;
+
+	if (!(b = malloc((2 * n->nranges + 1) * sizeof(wchar_t))))
+		return false;
+	b[j++] = 0;
+	for (i = 0; i < n->nranges; i++) {
+		b[j++] = n->ranges[i].lo;
+		if (n->ranges[i].hi != WCHAR_MAX)
+			b[j++] = n->ranges[i].hi + 1;
+	}
+	qsort(b, j, sizeof(wchar_t), cmpwchar);
+	for (d->nclasses = 0, i = 0; i < j; i++)
+		if (!i || b[i] != b[i - 1])
+			b[d->nclasses++] = b[i];
+	d->bounds = b;
+	for (i = 0; i < 128; i++)
+		d->ascii[i] = boundclass(b, d->nclasses, i);
+	return true;
+}
+
+static struct Dfa *
+dfafree(struct Dfa *d) {
+	if (d) {
+		free(d->bounds);
+		free(d->next);
+		free(d->accept);
+		free(d);
+	}
+	return NULL;
+}
+
+typedef struct {
+	const Nfa *n;
+	struct Dfa *d;
+	unsigned int words;         /* length of a node set */
+	unsigned int *sets;         /* node set of every DFA state */
+	unsigned int ssets, snext, saccept;
+	bool *endok;                /* NEol nodes followed by a match at the end */
+} Subsets;
+
+/* returns the DFA state for a node set, adding it if it is new */
+static unsigned int
+dfastate(Subsets *b, const unsigned int *set) {
+	struct Dfa *d = b->d;
+	unsigned int i, x;
+
+	for (i = 0; i < d->nstates; i++)
+		if (!memcmp(b->sets + i * b->words, set, b->words * sizeof(unsigned int)))
+			return i;
+	if (d->nstates == MAXDFASTATES
+	|| !grow((void **)&b->sets, &b->ssets, (d->nstates + 1) * b->words - 1, sizeof(unsigned int))
+	|| !grow((void **)&d->next, &b->snext, (d->nstates + 1) * d->nclasses - 1, sizeof(unsigned int))
+	|| !grow((void **)&d->accept, &b->saccept, d->nstates, sizeof(unsigned char)))
+		return NONE;
+	memcpy(b->sets + i * b->words, set, b->words * sizeof(unsigned int));
+	d->accept[i] = 0;
+	for (x = 0; x < b->n->nnodes; x++)
+		if (MATCHISSET(set, x) && b->n->nodes[x].type == NMatch)
+			d->accept[i] = AcceptNow | AcceptAtEnd;
+		else if (MATCHISSET(set, x) && b->endok[x])
+			d->accept[i] |= AcceptAtEnd;
+	for (x = 0; x < b->words && !set[x]; x++);
+	if (x == b->words)
+		d->dead = i;
+	return d->nstates++;
+}
+
+/* Subset construction, a DFA state is the set of NChar, NMatch and NEol
+ * nodes the NFA may be in. State 0 is the start of the text, the only
+ * place ^ can be passed. $ is only passed once the text has ended, see
+ * Dfa.accept and Dfa.acceptempty. */
+static struct Dfa *
+dfacompile(const Nfa *n, unsigned int start, struct Dfa *d) {
+	Subsets b = { 0 };
+	unsigned int *first, *again, *cur, *stack, *seen, stamp = 0, s, k, i, x;
+	bool ok = false;
+
+	b.n = n;
+	b.d = d;
+	b.words = n->nnodes / MATCHBITS + 1;
+	d->dead = NONE;
+	stack = malloc((2 * n->nnodes + 1) * sizeof(unsigned int));
+	seen = calloc(n->nnodes, sizeof(unsigned int));
+	first = calloc(3 * b.words, sizeof(unsigned int));
+	b.endok = calloc(n->nnodes, sizeof(bool));
+	if (!stack || !seen || !first || !b.endok || !dfaclasses(d, n))
+		goto out;
+	again = first + b.words;
+	cur = again + b.words;
+
+	for (x = 0; x < n->nnodes; x++)
+		if (n->nodes[x].type == NEol) {
+			memset(cur, 0, b.words * sizeof(unsigned int));
+			nfaclose(n, n->nodes[x].out, AtEnd, cur, stack, seen, ++stamp);
+			b.endok[x] = nfaaccepts(n, cur);
+		}
+	memset(cur, 0, b.words * sizeof(unsigned int));
+	nfaclose(n, start, AtStart | AtEnd, cur, stack, seen, ++stamp);
+	d->acceptempty = nfaaccepts(n, cur);
+	nfaclose(n, start, AtStart, first, stack, seen, ++stamp);
+	nfaclose(n, start, 0, again, stack, seen, ++stamp);
+	if (dfastate(&b, first) == NONE)
+		goto out;
+	for (s = 0; s < d->nstates; s++) {
+		for (k = 0; k < d->nclasses; k++) {
+			memset(cur, 0, b.words * sizeof(unsigned int));
+			stamp++;
+			for (x = 0; x < n->nnodes; x++)
+				if (MATCHISSET(b.sets + s * b.words, x) && n->nodes[x].type == NChar
+				&& nfahas(n, &n->nodes[x], d->bounds[k]))
+					nfaclose(n, n->nodes[x].out, 0, cur, stack, seen, stamp);
+			/* a match may start at every character, past the start of
+			 * the text a leading ^ fails though */
+			for (i = 0; i < b.words; i++)
+				cur[i] |= again[i];
+			if ((i = dfastate(&b, cur)) == NONE)
+				goto out;
+			d->next[s * d->nclasses + k] = i;
+		}
+	}
+	ok = true;
+out:
+	free(stack);
+	free(seen);
+	free(first);
+	free(b.sets);
+	free(b.endok);
+	return ok ? d : dfafree(d);
+}
+
+static bool
+dfarun(const struct Dfa *d, const wchar_t *text) {
+	unsigned int s = 0;
+	wchar_t c;
+
+	if (!*text)
+		return d->acceptempty;
+	for (; *text; text++) {
+		if (d->accept[s] & AcceptNow)
+			return true;
+		c = d->flags & MatchFoldCase ? (wchar_t)towlower(*text) : *text;
+		if ((unsigned int)c < 128)
+			s = d->next[s * d->nclasses + d->ascii[c]];
+		else
+			s = d->next[s * d->nclasses + boundclass(d->bounds, d->nclasses, c)];
+		if (s == d->dead)
+			return false;
+	}
+	return d->accept[s] & AcceptAtEnd;
+}
+
+static bool
+addpattern(Matcher *m, const wchar_t *pattern, bool glob, unsigned int id) {
+	Nfa n = { 0 };
+	Frag f;
+	struct Dfa *d;
+
+	if (!(d = calloc(1, sizeof(struct Dfa))))
+		return false;
+	d->id = id;
+	d->whole = glob;
+	n.flags = d->flags = m->flags;
+	n.p = pattern;
+	n.end = pattern + wcslen(pattern);
+	f = glob ? nfaglob(&n) : nfaalt(&n);
+	if (!n.error && n.p < n.end)
+		n.error = true; /* unbalanced ) */
+	if (!n.error)
+		nfapatch(&n, f.end, nfanode(&n, NMatch));
+	d = n.error ? dfafree(d) : dfacompile(&n, f.start, d);
+	free(n.nodes);
+	free(n.ranges);
+	if (!d || !grow((void **)&m->dfas, &m->sdfas, m->ndfas, sizeof(struct Dfa *))) {
+		dfafree(d);
+		return false;
+	}
+	m->dfas[m->ndfas++] = d;
+	return true;
+}
+
+bool
+matchaddglob(Matcher *m, const wchar_t *glob, unsigned int id) {
+	return addpattern(m, glob, true, id);
+}
+
+bool
+matchaddregex(Matcher *m, const wchar_t *regex, unsigned int id) {
+	return addpattern(m, regex, false, id);
+}
+
+void
+matchrun(const Matcher *m, const wchar_t *text, unsigned int *set) {
+	const State *st = m->states;
+	unsigned int s = 0, t, o, i;
+
+	for (i = 0; i < m->ndfas; i++)
+		if (!m->dfas[i]->whole && dfarun(m->dfas[i], text))
+			MATCHSET(set, m->dfas[i]->id);
+	if (!m->compiled || (m->nstates == 1 && !st[0].nids))
+		return;
+	/* empty patterns match anything */
+	for (i = st[0].ids; i < st[0].ids + st[0].nids; i++)
+		MATCHSET(set, m->ids[i]);
+	for (; *text; text++) {
+		while ((t = step(m, s, *text)) == NONE && s)
+			s = st[s].fail;
+		s = t == NONE ? 0 : t;
+		for (o = st[s].nids ? s : st[s].dict; o; o = st[o].dict)
+			for (i = st[o].ids; i < st[o].ids + st[o].nids; i++)
+				MATCHSET(set, m->ids[i]);
+	}
+}
+
+void
+matchexact(const Matcher *m, const wchar_t *key, unsigned int *set) {
+	const Slot *slot;
+	unsigned int h, i;
+
+	for (i = 0; i < m->ndfas; i++)
+		if (m->dfas[i]->whole && dfarun(m->dfas[i], key))
+			MATCHSET(set, m->dfas[i]->id);
+	if (!m->tablesize)
+		return;
+	h = hashkey(key, m->flags);
+	for (slot = &m->table[h & (m->tablesize - 1)]; slot->key;) {
+		if (slot->hash == h && !keycmp(slot->key, key, m->flags)) {
+			for (i = slot->ids; i < slot->ids + slot->nids; i++)
+				MATCHSET(set, m->exactids[i]);
+			return;
+		}
+		slot = slot + 1 < m->table + m->tablesize ? slot + 1 : m->table;
+	}
+}
+
+void
+matchfree(Matcher *m) {
+	if (!m)
+		return;
+	free(m->states);
+	free(m->edges);
+	free(m->outs);
+	free(m->ids);
+	free(m->keys);
+	free(m->table);
+	free(m->exactids);
+	while (m->ndfas)
+		dfafree(m->dfas[--m->ndfas]);
+	free(m->dfas);
+	free(m);
+}
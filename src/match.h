@@ -0,0 +1,31 @@
+#ifndef DWM_MATCH
+#define DWM_MATCH
+
+#include <stdbool.h>
+#include <wchar.h>
+
+/* A Matcher holds any number of patterns, each tagged with an id. Once
+ * compiled it scans a text in a single pass and sets bit id in a caller
+ * provided bitset for every pattern found in it.
+ *
+ * matchrun() reports substrings and regular expressions found anywhere in
+ * a text, matchexact() reports exact keys and globs matching a whole key. */
+typedef struct Matcher Matcher;
+
+#define MatchFoldCase 1 /* exact keys, globs and regexes ignore case */
+
+#define MATCHBITS (sizeof(unsigned int) * 8)
+#define MATCHSET(set, id) ((set)[(id) / MATCHBITS] |= 1u << (id) % MATCHBITS)
+#define MATCHISSET(set, id) ((set)[(id) / MATCHBITS] & 1u << (id) % MATCHBITS)
+
+Matcher *matchnew(unsigned int flags);
+bool matchadd(Matcher *m, const wchar_t *pattern, unsigned int id);
+bool matchaddexact(Matcher *m, const wchar_t *key, unsigned int id); /* key is referenced, not copied */
+bool matchaddglob(Matcher *m, const wchar_t *glob, unsigned int id);
+bool matchaddregex(Matcher *m, const wchar_t *regex, unsigned int id);
+bool matchcompile(Matcher *m);
+void matchrun(const Matcher *m, const wchar_t *text, unsigned int *set);
+void matchexact(const Matcher *m, const wchar_t *key, unsigned int *set);
+void matchfree(Matcher *m);
+
+#endif
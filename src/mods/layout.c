@@ -0,0 +1,171 @@
+#include "layout.h"
+
+#include <limits.h>
+#include <stdint.h>
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+#include <compat-5.3.h>
+
+#include <windows.h>
+
+#define GEOMETRY "dwm.layout.geometry"
+
+/* the arrangement a Lua layout is computing, see dwm_layout_run() */
+typedef struct {
+	unsigned int n;
+	const LayoutRects *r;
+	HWND (*hwnd)(unsigned int i);
+} LayoutCall;
+
+static int checkcoord(lua_State *L, int arg);
+static unsigned int checkslot(lua_State *L);
+
+static int f_geometry_get(lua_State *L);
+static int f_geometry_hwnd(lua_State *L);
+static int f_geometry_len(lua_State *L);
+static int f_geometry_set(lua_State *L);
+
+static LayoutCall call;
+/* created once and handed to every call so arranging allocates nothing */
+static int arearef = LUA_NOREF, geometryref = LUA_NOREF, libref = LUA_NOREF;
+
+int
+luaopen_dwm_layout(lua_State *L) {
+	const luaL_Reg lib[] = {
+		{ NULL, NULL }
+	};
+	const luaL_Reg geometry[] = {
+		{ "get", f_geometry_get },
+		{ "hwnd", f_geometry_hwnd },
+		{ "set", f_geometry_set },
+		{ NULL, NULL }
+	};
+
+	luaL_newmetatable(L, GEOMETRY);
+	luaL_newlib(L, geometry);
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, f_geometry_len);
+	lua_setfield(L, -2, "__len");
+	lua_pop(L, 1);
+
+	lua_newuserdata(L, 1);
+	luaL_setmetatable(L, GEOMETRY);
+	geometryref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	lua_createtable(L, 0, 5);
+	arearef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	luaL_newlib(L, lib);
+	lua_pushvalue(L, -1);
+	libref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	return 1;
+}
+
+/* Calls the Lua layout ref as fn(n, area, geometry). The geometry starts
+ * out as the work area for every client, fn overwrites what it arranges.
+ * Returns false if fn raised an error, the message is kept in
+ * dwm.layout.error. */
+bool
+dwm_layout_run(lua_State *L, int ref, const LayoutParams *p, unsigned int n, const LayoutRects *r, HWND (*hwnd)(unsigned int i)) {
+	unsigned int i;
+	bool ok;
+
+	for (i = 0; i < n; i++) {
+		r->x[i] = p->x;
+		r->y[i] = p->y;
+		r->w[i] = p->w;
+		r->h[i] = p->h;
+	}
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+	lua_pushinteger(L, n);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, arearef);
+	lua_pushinteger(L, p->x);
+	lua_setfield(L, -2, "x");
+	lua_pushinteger(L, p->y);
+	lua_setfield(L, -2, "y");
+	lua_pushinteger(L, p->w);
+	lua_setfield(L, -2, "w");
+	lua_pushinteger(L, p->h);
+	lua_setfield(L, -2, "h");
+	lua_pushnumber(L, (lua_Number)p->mfact / (1 << MFACTBITS));
+	lua_setfield(L, -2, "mfact");
+	lua_rawgeti(L, LUA_REGISTRYINDEX, geometryref);
+
+	call.n = n;
+	call.r = r;
+	call.hwnd = hwnd;
+	ok = lua_pcall(L, 3, 0, 0) == LUA_OK;
+	call.n = 0;
+
+	if (!ok) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, libref);
+		lua_insert(L, -2);
+		lua_setfield(L, -2, "error");
+		lua_pop(L, 1);
+	}
+	return ok;
+}
+
+/* argument arg as a coordinate, NaN and numbers an int can't hold are
+ * errors rather than undefined conversions */
+static int
+checkcoord(lua_State *L, int arg) {
+	lua_Number v = luaL_checknumber(L, arg);
+
+	luaL_argcheck(L, v >= INT_MIN && v <= INT_MAX, arg, "coordinate out of range");
+	return (int)v;
+}
+
+/* index argument 2 of a geometry method, 1 based in Lua */
+static unsigned int
+checkslot(lua_State *L) {
+	lua_Integer i;
+
+	luaL_checkudata(L, 1, GEOMETRY);
+	i = luaL_checkinteger(L, 2);
+	luaL_argcheck(L, i >= 1 && i <= call.n, 2, "no such client");
+	return i - 1;
+}
+
+/* geometry:get(i) returns x, y, w and h of client i */
+static int
+f_geometry_get(lua_State *L) {
+	unsigned int i = checkslot(L);
+
+	lua_pushinteger(L, call.r->x[i]);
+	lua_pushinteger(L, call.r->y[i]);
+	lua_pushinteger(L, call.r->w[i]);
+	lua_pushinteger(L, call.r->h[i]);
+	return 4;
+}
+
+/* geometry:hwnd(i) returns the client id of client i */
+static int
+f_geometry_hwnd(lua_State *L) {
+	unsigned int i = checkslot(L);
+
+	lua_pushnumber(L, (uint32_t)(uintptr_t)call.hwnd(i));
+	return 1;
+}
+
+static int
+f_geometry_len(lua_State *L) {
+	lua_pushinteger(L, call.n);
+	return 1;
+}
+
+/* geometry:set(i, x, y, w, h) places client i */
+static int
+f_geometry_set(lua_State *L) {
+	unsigned int i = checkslot(L);
+
+	call.r->x[i] = checkcoord(L, 3);
+	call.r->y[i] = checkcoord(L, 4);
+	call.r->w[i] = checkcoord(L, 5);
+	call.r->h[i] = checkcoord(L, 6);
+	return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef DWM_MOD_LAYOUT
+#define DWM_MOD_LAYOUT
+
+#include <stdbool.h>
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+
+#include <windows.h>
+
+#include "../layout.h"
+
+int luaopen_dwm_layout(lua_State *L);
+
+bool dwm_layout_run(lua_State *L, int ref, const LayoutParams *p, unsigned int n, const LayoutRects *r, HWND (*hwnd)(unsigned int i));
+
+#endif
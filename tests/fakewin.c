@@ -0,0 +1,1093 @@
+/* See fakewin.h */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#include <dwmapi.h>
+#include <shellapi.h>
+
+#include "fakewin.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define EVENT_OBJECT_CLOAKED 0x8017
+#define EVENT_OBJECT_UNCLOAKED 0x8018
+#define WM_FAKEWINEVENT (WM_APP + 0x3fff) /* posted to no window, see winevent() */
+
+typedef struct {
+	HWND hwnd;
+	int x, y, w, h;
+	UINT flags;
+} Move;
+
+FakeCalls fakecalls;
+RECT fakeworkarea = { 0, 0, 1920, 1040 };
+unsigned int fakefaildefer;
+bool fakefailend;
+
+static FakeWindow windows[FAKEMAXWINDOWS]; /* indexed by HWND, 0 is no window */
+static unsigned int nwindows = 1, nextwindow = 1;
+static struct {
+	wchar_t name[64];
+	WNDPROC proc;
+} classes[8];
+static MSG *queue;
+static unsigned int queuehead, queuelen, queuesize;
+static struct {
+	Move *moves;
+	unsigned int n, size, calls;
+} transaction;
+static struct {
+	DWORD min, max;
+	WINEVENTPROC proc;
+} hooks[8];
+static struct {
+	DWORD pid;
+	wchar_t image[MAX_PATH];
+	bool denied, exited;
+} processes[1024]; /* handles are indexes plus one, see OpenProcess() */
+static unsigned int nprocesses;
+static struct {
+	HWND hwnd;
+	UINT_PTR id;
+	UINT ms;
+	unsigned long due;
+} timers[256];
+static unsigned int ntimers;
+static unsigned long elapsed; /* ms fakesleep() let pass */
+static HWND foreground;
+static HWND shellwindow; /* gets the shell hook messages, see shellhook() */
+
+/* The shell tells about top-level application windows appearing and
+ * disappearing, also when they are merely shown or hidden. */
+static void
+shellhook(FakeWindow *f, WPARAM code) {
+	if (shellwindow && !f->parent && !(f->exstyle & WS_EX_TOOLWINDOW))
+		PostMessageW(shellwindow, RegisterWindowMessageW(L"SHELLHOOK"), code, (LPARAM)(f - windows));
+}
+
+/* Out of context hooks get their events through the message loop of the
+ * thread which set them. */
+static void
+winevent(FakeWindow *f, DWORD event) {
+	PostMessageW(NULL, WM_FAKEWINEVENT, event, (LPARAM)(f - windows));
+}
+
+static int
+copy(wchar_t *dst, const wchar_t *src, int n) {
+	int len = wcslen(src);
+
+	if (n <= 0)
+		return 0;
+	if (len >= n)
+		len = n - 1;
+	wmemcpy(dst, src, len);
+	dst[len] = L'\0';
+	return len;
+}
+
+static void
+move(FakeWindow *f, int x, int y, int w, int h, UINT flags) {
+	LONG style = f->style;
+
+	if (!(flags & SWP_NOMOVE)) {
+		f->x = x;
+		f->y = y;
+	}
+	if (!(flags & SWP_NOSIZE)) {
+		f->w = w;
+		f->h = h;
+	}
+	if (flags & SWP_SHOWWINDOW)
+		f->style |= WS_VISIBLE;
+	if (flags & SWP_HIDEWINDOW)
+		f->style &= ~WS_VISIBLE;
+	if ((style ^ f->style) & WS_VISIBLE)
+		shellhook(f, f->style & WS_VISIBLE ? HSHELL_WINDOWCREATED : HSHELL_WINDOWDESTROYED);
+}
+
+static HWND
+newwindow(const wchar_t *class, const wchar_t *title, LONG style, LONG exstyle, HWND parent) {
+	unsigned int i, k;
+	FakeWindow *f;
+
+	/* hand out handles round robin, a window's handle is not reused right away */
+	for (k = 0; k < FAKEMAXWINDOWS - 1; k++) {
+		i = nextwindow++;
+		if (nextwindow == FAKEMAXWINDOWS)
+			nextwindow = 1;
+		if (!windows[i].used)
+			break;
+	}
+	if (k == FAKEMAXWINDOWS - 1)
+		return NULL;
+	f = &windows[i];
+	memset(f, 0, sizeof *f);
+	f->used = true;
+	f->parent = parent;
+	f->style = style;
+	f->exstyle = exstyle;
+	f->pid = 1000 + i % 16;
+	copy(f->class, class ? class : L"", LENGTH(f->class));
+	copy(f->title, title ? title : L"", LENGTH(f->title));
+	for (k = 0; k < LENGTH(classes); k++)
+		if (classes[k].proc && !wcscmp(classes[k].name, f->class))
+			f->proc = classes[k].proc;
+	if (i >= nwindows)
+		nwindows = i + 1;
+	return (HWND)(uintptr_t)i;
+}
+
+static WORD
+registerclass(LPCWSTR name, WNDPROC proc) {
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(classes); i++)
+		if (!classes[i].proc) {
+			copy(classes[i].name, name, LENGTH(classes[i].name));
+			classes[i].proc = proc;
+			return i + 1;
+		}
+	return 0;
+}
+
+HWND
+fakecreate(const wchar_t *class, const wchar_t *title, LONG style) {
+	HWND hwnd = newwindow(class, title, style, 0, NULL);
+
+	if (hwnd && style & WS_VISIBLE)
+		shellhook(fakewindow(hwnd), HSHELL_WINDOWCREATED);
+	return hwnd;
+}
+
+/* the shell only tells about top-level windows */
+HWND
+fakecreatechild(HWND parent, const wchar_t *class, const wchar_t *title, LONG style, LONG exstyle) {
+	return fakewindow(parent) ? newwindow(class, title, style, exstyle, parent) : NULL;
+}
+
+void
+fakedestroy(HWND hwnd) {
+	FakeWindow *f = fakewindow(hwnd);
+	unsigned int i;
+
+	if (!f)
+		return;
+	if (f->style & WS_VISIBLE)
+		shellhook(f, HSHELL_WINDOWDESTROYED);
+	if (hwnd == shellwindow)
+		shellwindow = NULL;
+	/* the timers of a window go with it */
+	for (i = ntimers; i-- > 0;)
+		if (timers[i].hwnd == hwnd)
+			timers[i] = timers[--ntimers];
+	f->used = false;
+}
+
+/* the user brings hwnd to the front, say by clicking it in the taskbar */
+void
+fakeactivate(HWND hwnd) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return;
+	foreground = hwnd;
+	shellhook(f, HSHELL_WINDOWACTIVATED);
+}
+
+void
+fakesettitle(HWND hwnd, const wchar_t *title) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return;
+	copy(f->title, title, LENGTH(f->title));
+	winevent(f, EVENT_OBJECT_NAMECHANGE);
+}
+
+/* the system hides a window while it is suspended or on another desktop */
+void
+fakecloak(HWND hwnd, bool cloaked) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return;
+	f->cloaked = cloaked;
+	winevent(f, cloaked ? EVENT_OBJECT_CLOAKED : EVENT_OBJECT_UNCLOAKED);
+}
+
+/* a process started earlier with pid has to have exited, the pid is
+ * reused then */
+void
+fakestartprocess(DWORD pid, const wchar_t *image, bool denied) {
+	if (nprocesses == LENGTH(processes))
+		return;
+	processes[nprocesses].pid = pid;
+	copy(processes[nprocesses].image, image, LENGTH(processes[nprocesses].image));
+	processes[nprocesses].denied = denied;
+	processes[nprocesses++].exited = false;
+}
+
+/* its handles become signaled */
+void
+fakeexitprocess(DWORD pid) {
+	unsigned int i;
+
+	for (i = 0; i < nprocesses; i++)
+		if (processes[i].pid == pid)
+			processes[i].exited = true;
+}
+
+/* the next window gets hwnd if it is free, as handles are reused on Windows */
+void
+fakenexthandle(HWND hwnd) {
+	uintptr_t i = (uintptr_t)hwnd;
+
+	if (i > 0 && i < FAKEMAXWINDOWS)
+		nextwindow = i;
+}
+
+void
+fakepump(void) {
+	MSG msg;
+
+	while (GetMessageW(&msg, NULL, 0, 0) > 0)
+		DispatchMessageW(&msg);
+}
+
+/* lets ms pass, a timer which came due posts one WM_TIMER however many
+ * times it would have gone off, as the real ones do */
+void
+fakesleep(unsigned int ms) {
+	unsigned int i;
+
+	elapsed += ms;
+	for (i = 0; i < ntimers; i++)
+		if (timers[i].due <= elapsed) {
+			PostMessageW(timers[i].hwnd, WM_TIMER, timers[i].id, 0);
+			timers[i].due = elapsed + timers[i].ms;
+		}
+}
+
+FakeWindow *
+fakewindow(HWND hwnd) {
+	uintptr_t i = (uintptr_t)hwnd;
+
+	return i > 0 && i < nwindows && windows[i].used ? &windows[i] : NULL;
+}
+
+/* windows */
+
+BOOL
+CloseHandle(HANDLE h) {
+	return TRUE;
+}
+
+HWND
+CreateWindowExW(DWORD exstyle, LPCWSTR class, LPCWSTR title, DWORD style, int x, int y, int w, int h, HWND parent, HMENU menu, HINSTANCE inst, LPVOID param) {
+	HWND hwnd = newwindow(class, title, style, exstyle, parent);
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (f) {
+		move(f, x, y, w, h, 0);
+		if (f->proc)
+			f->proc(hwnd, WM_CREATE, 0, 0);
+	}
+	return hwnd;
+}
+
+LRESULT
+DefWindowProcW(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	return 0;
+}
+
+BOOL
+DestroyWindow(HWND hwnd) {
+	if (!fakewindow(hwnd))
+		return FALSE;
+	fakedestroy(hwnd);
+	return TRUE;
+}
+
+/* calls f for the children of parent, and for their children as well
+ * if descend is set, until f returns FALSE */
+static BOOL
+enumwindows(HWND parent, bool descend, WNDENUMPROC f, LPARAM lParam) {
+	unsigned int i;
+
+	for (i = 1; i < nwindows; i++) {
+		if (!windows[i].used || windows[i].parent != parent)
+			continue;
+		if (!f((HWND)(uintptr_t)i, lParam))
+			return FALSE;
+		if (descend && !enumwindows((HWND)(uintptr_t)i, true, f, lParam))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL
+EnumChildWindows(HWND parent, WNDENUMPROC f, LPARAM lParam) {
+	enumwindows(parent, true, f, lParam);
+	return TRUE;
+}
+
+BOOL
+EnumWindows(WNDENUMPROC f, LPARAM lParam) {
+	enumwindows(NULL, false, f, lParam);
+	return TRUE;
+}
+
+HWND
+FindWindowW(LPCWSTR class, LPCWSTR title) {
+	unsigned int i;
+
+	for (i = 1; i < nwindows; i++)
+		if (windows[i].used && (!class || !wcscmp(windows[i].class, class))
+		&& (!title || !wcscmp(windows[i].title, title)))
+			return (HWND)(uintptr_t)i;
+	return NULL;
+}
+
+int
+GetClassNameW(HWND hwnd, LPWSTR buf, int n) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	fakecalls.getclass++;
+	return f ? copy(buf, f->class, n) : 0;
+}
+
+HWND
+GetDesktopWindow(void) {
+	return (HWND)(uintptr_t)FAKEMAXWINDOWS;
+}
+
+HWND
+GetForegroundWindow(void) {
+	return foreground;
+}
+
+HWND
+GetParent(HWND hwnd) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	return f && f->parent != HWND_MESSAGE ? f->parent : NULL;
+}
+
+HWND
+GetWindow(HWND hwnd, UINT cmd) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	return f && cmd == GW_OWNER ? f->owner : NULL;
+}
+
+BOOL
+GetWindowInfo(HWND hwnd, WINDOWINFO *wi) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return FALSE;
+	wi->rcWindow.left = f->x;
+	wi->rcWindow.top = f->y;
+	wi->rcWindow.right = f->x + f->w;
+	wi->rcWindow.bottom = f->y + f->h;
+	wi->rcClient = wi->rcWindow;
+	wi->dwStyle = f->style;
+	wi->dwExStyle = f->exstyle;
+	return TRUE;
+}
+
+LONG
+GetWindowLongW(HWND hwnd, int index) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return 0;
+	return index == GWL_STYLE ? f->style : index == GWL_EXSTYLE ? f->exstyle : 0;
+}
+
+int
+GetWindowTextLengthW(HWND hwnd) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	return f ? wcslen(f->title) : 0;
+}
+
+int
+GetWindowTextW(HWND hwnd, LPWSTR buf, int n) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	fakecalls.gettext++;
+	return f ? copy(buf, f->title, n) : 0;
+}
+
+DWORD
+GetWindowThreadProcessId(HWND hwnd, LPDWORD pid) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	fakecalls.processid++;
+	if (!f)
+		return 0;
+	if (pid)
+		*pid = f->pid;
+	return f->pid;
+}
+
+BOOL
+IsIconic(HWND hwnd) {
+	return (GetWindowLongW(hwnd, GWL_STYLE) & WS_MINIMIZE) != 0;
+}
+
+BOOL
+IsWindow(HWND hwnd) {
+	return fakewindow(hwnd) != NULL;
+}
+
+BOOL
+IsWindowVisible(HWND hwnd) {
+	return (GetWindowLongW(hwnd, GWL_STYLE) & WS_VISIBLE) != 0;
+}
+
+WORD
+RegisterClassExW(const WNDCLASSEXW *wc) {
+	return registerclass(wc->lpszClassName, wc->lpfnWndProc);
+}
+
+WORD
+RegisterClassW(const WNDCLASSW *wc) {
+	return registerclass(wc->lpszClassName, wc->lpfnWndProc);
+}
+
+BOOL
+SetForegroundWindow(HWND hwnd) {
+	if (!fakewindow(hwnd))
+		return FALSE;
+	foreground = hwnd;
+	return TRUE;
+}
+
+LONG
+SetWindowLongW(HWND hwnd, int index, LONG value) {
+	FakeWindow *f = fakewindow(hwnd);
+	LONG old;
+
+	if (!f)
+		return 0;
+	if (index == GWL_STYLE) {
+		old = f->style;
+		f->style = value;
+	} else {
+		old = f->exstyle;
+		f->exstyle = value;
+	}
+	return old;
+}
+
+BOOL
+SetWindowPlacement(HWND hwnd, const WINDOWPLACEMENT *wp) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	if (!f)
+		return FALSE;
+	if (wp->showCmd == SW_RESTORE)
+		f->style &= ~(WS_MINIMIZE | WS_MAXIMIZE);
+	return TRUE;
+}
+
+BOOL
+ShowWindow(HWND hwnd, int cmd) {
+	FakeWindow *f = fakewindow(hwnd);
+	BOOL wasvisible;
+
+	if (!f)
+		return FALSE;
+	wasvisible = (f->style & WS_VISIBLE) != 0;
+	move(f, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | (cmd == SW_HIDE ? SWP_HIDEWINDOW : SWP_SHOWWINDOW));
+	return wasvisible;
+}
+
+/* moving windows, a transaction applies either all its moves or none */
+
+HDWP
+BeginDeferWindowPos(int n) {
+	transaction.n = transaction.calls = 0;
+	return &transaction;
+}
+
+HDWP
+DeferWindowPos(HDWP hdwp, HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags) {
+	Move *m;
+
+	if (hdwp != &transaction || !fakewindow(hwnd))
+		return NULL;
+	if (++transaction.calls == fakefaildefer) {
+		/* the system frees the transaction, nothing collected is applied */
+		transaction.n = 0;
+		return NULL;
+	}
+	if (transaction.n == transaction.size) {
+		transaction.size = transaction.size ? 2 * transaction.size : 64;
+		if (!(m = realloc(transaction.moves, transaction.size * sizeof(Move))))
+			return NULL;
+		transaction.moves = m;
+	}
+	m = &transaction.moves[transaction.n++];
+	m->hwnd = hwnd;
+	m->x = x;
+	m->y = y;
+	m->w = w;
+	m->h = h;
+	m->flags = flags;
+	fakecalls.deferred++;
+	return hdwp;
+}
+
+BOOL
+EndDeferWindowPos(HDWP hdwp) {
+	unsigned int i;
+	FakeWindow *f;
+
+	if (hdwp != &transaction || fakefailend) {
+		transaction.n = 0;
+		return FALSE;
+	}
+	for (i = 0; i < transaction.n; i++)
+		if ((f = fakewindow(transaction.moves[i].hwnd)))
+			move(f, transaction.moves[i].x, transaction.moves[i].y,
+			     transaction.moves[i].w, transaction.moves[i].h, transaction.moves[i].flags);
+	transaction.n = 0;
+	fakecalls.commits++;
+	return TRUE;
+}
+
+BOOL
+SetWindowPos(HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	fakecalls.setwindowpos++;
+	if (!f)
+		return FALSE;
+	move(f, x, y, w, h, flags);
+	return TRUE;
+}
+
+/* messages and events, posted messages wait in queue for fakepump() */
+
+BOOL
+DeregisterShellHookWindow(HWND hwnd) {
+	if (hwnd != shellwindow)
+		return FALSE;
+	shellwindow = NULL;
+	return TRUE;
+}
+
+LRESULT
+DispatchMessageW(const MSG *msg) {
+	FakeWindow *f = fakewindow(msg->hwnd);
+	unsigned int i;
+
+	if (!msg->hwnd && msg->message == WM_FAKEWINEVENT) {
+		for (i = 0; i < LENGTH(hooks); i++)
+			if (hooks[i].proc && hooks[i].min <= msg->wParam && msg->wParam <= hooks[i].max)
+				hooks[i].proc((HWINEVENTHOOK)(uintptr_t)(i + 1), msg->wParam, (HWND)msg->lParam,
+				              OBJID_WINDOW, CHILDID_SELF, 0, GetTickCount());
+		return 0;
+	}
+	return f && f->proc ? f->proc(msg->hwnd, msg->message, msg->wParam, msg->lParam) : 0;
+}
+
+BOOL
+GetMessageW(MSG *msg, HWND hwnd, UINT min, UINT max) {
+	if (!queuelen)
+		return FALSE; /* as if WM_QUIT arrived, the loop ends */
+	*msg = queue[queuehead];
+	queuehead = (queuehead + 1) % queuesize;
+	queuelen--;
+	return msg->message != WM_QUIT;
+}
+
+BOOL
+KillTimer(HWND hwnd, UINT_PTR id) {
+	unsigned int i;
+
+	for (i = 0; i < ntimers; i++)
+		if (timers[i].hwnd == hwnd && timers[i].id == id) {
+			timers[i] = timers[--ntimers];
+			return TRUE;
+		}
+	return FALSE;
+}
+
+BOOL
+PeekMessageW(MSG *msg, HWND hwnd, UINT min, UINT max, UINT remove) {
+	if (!queuelen)
+		return FALSE;
+	if (remove & PM_REMOVE)
+		GetMessageW(msg, hwnd, min, max);
+	else
+		*msg = queue[queuehead];
+	return TRUE;
+}
+
+BOOL
+PostMessageW(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	MSG *q;
+	unsigned int i;
+
+	if (hwnd && !fakewindow(hwnd))
+		return FALSE;
+	if (queuelen == queuesize) {
+		if (!(q = malloc((queuesize ? 2 * queuesize : 64) * sizeof(MSG))))
+			return FALSE;
+		for (i = 0; i < queuelen; i++)
+			q[i] = queue[(queuehead + i) % queuesize];
+		free(queue);
+		queue = q;
+		queuehead = 0;
+		queuesize = queuesize ? 2 * queuesize : 64;
+	}
+	q = &queue[(queuehead + queuelen++) % queuesize];
+	memset(q, 0, sizeof *q);
+	q->hwnd = hwnd;
+	q->message = msg;
+	q->wParam = wParam;
+	q->lParam = lParam;
+	return TRUE;
+}
+
+void
+PostQuitMessage(int code) {
+	PostMessageW(NULL, WM_QUIT, code, 0);
+}
+
+BOOL
+RegisterHotKey(HWND hwnd, int id, UINT mod, UINT key) {
+	return TRUE;
+}
+
+BOOL
+RegisterShellHookWindow(HWND hwnd) {
+	if (!fakewindow(hwnd))
+		return FALSE;
+	shellwindow = hwnd;
+	return TRUE;
+}
+
+UINT
+RegisterWindowMessageW(LPCWSTR name) {
+	return 0xC000;
+}
+
+LRESULT
+SendMessageA(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	return f && f->proc ? f->proc(hwnd, msg, wParam, lParam) : 0;
+}
+
+/* setting a timer which is already set starts it over */
+UINT_PTR
+SetTimer(HWND hwnd, UINT_PTR id, UINT ms, TIMERPROC f) {
+	unsigned int i;
+
+	if (!fakewindow(hwnd))
+		return 0;
+	for (i = 0; i < ntimers && (timers[i].hwnd != hwnd || timers[i].id != id); i++);
+	if (i == ntimers) {
+		if (ntimers == LENGTH(timers))
+			return 0;
+		ntimers++;
+	}
+	timers[i].hwnd = hwnd;
+	timers[i].id = id;
+	timers[i].ms = ms;
+	timers[i].due = elapsed + ms;
+	return id;
+}
+
+HWINEVENTHOOK
+SetWinEventHook(DWORD min, DWORD max, HMODULE mod, WINEVENTPROC f, DWORD pid, DWORD tid, DWORD flags) {
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(hooks); i++)
+		if (!hooks[i].proc) {
+			hooks[i].min = min;
+			hooks[i].max = max;
+			hooks[i].proc = f;
+			return (HWINEVENTHOOK)(uintptr_t)(i + 1);
+		}
+	return NULL;
+}
+
+BOOL
+TranslateMessage(const MSG *msg) {
+	return FALSE;
+}
+
+BOOL
+UnhookWinEvent(HWINEVENTHOOK hook) {
+	uintptr_t i = (uintptr_t)hook;
+
+	if (i < 1 || i > LENGTH(hooks) || !hooks[i - 1].proc)
+		return FALSE;
+	hooks[i - 1].proc = NULL;
+	return TRUE;
+}
+
+BOOL
+UnregisterHotKey(HWND hwnd, int id) {
+	return TRUE;
+}
+
+/* drawing, nothing is drawn */
+
+HDC
+BeginPaint(HWND hwnd, PAINTSTRUCT *ps) {
+	return GetWindowDC(hwnd);
+}
+
+HBRUSH
+CreateSolidBrush(COLORREF col) {
+	return NULL;
+}
+
+HFONT
+CreateFontW(int h, int w, int esc, int orient, int weight, DWORD italic, DWORD underline, DWORD strikeout, DWORD charset, DWORD precision, DWORD clip, DWORD quality, DWORD pitch, LPCWSTR face) {
+	return (HFONT)1;
+}
+
+HPEN
+CreatePen(int style, int w, COLORREF col) {
+	return NULL;
+}
+
+BOOL
+DeleteObject(HGDIOBJ obj) {
+	return TRUE;
+}
+
+int
+DrawTextW(HDC hdc, LPCWSTR s, int n, RECT *r, UINT format) {
+	return 16;
+}
+
+BOOL
+EndPaint(HWND hwnd, const PAINTSTRUCT *ps) {
+	return TRUE;
+}
+
+int
+FillRect(HDC hdc, const RECT *r, HBRUSH brush) {
+	return 1;
+}
+
+HGDIOBJ
+GetStockObject(int i) {
+	return NULL;
+}
+
+DWORD
+GetSysColor(int i) {
+	return 0;
+}
+
+BOOL
+GetTextExtentPoint32W(HDC hdc, LPCWSTR s, int n, SIZE *size) {
+	size->cx = 8 * n;
+	size->cy = 16;
+	return TRUE;
+}
+
+HDC
+GetWindowDC(HWND hwnd) {
+	/* NULL is the device context of the whole screen */
+	if (!hwnd)
+		fakecalls.screendc++;
+	else if (!fakewindow(hwnd))
+		return NULL;
+	return (HDC)1;
+}
+
+BOOL
+LineTo(HDC hdc, int x, int y) {
+	return TRUE;
+}
+
+HCURSOR
+LoadCursorW(HINSTANCE inst, LPCWSTR name) {
+	return NULL;
+}
+
+BOOL
+MoveToEx(HDC hdc, int x, int y, POINT *p) {
+	return TRUE;
+}
+
+int
+ReleaseDC(HWND hwnd, HDC hdc) {
+	return 1;
+}
+
+HGDIOBJ
+SelectObject(HDC hdc, HGDIOBJ obj) {
+	return NULL;
+}
+
+int
+SetBkMode(HDC hdc, int mode) {
+	return TRANSPARENT;
+}
+
+BOOL
+SetSysColors(int n, const int *elements, const COLORREF *cols) {
+	return TRUE;
+}
+
+COLORREF
+SetTextColor(HDC hdc, COLORREF col) {
+	return 0;
+}
+
+/* system, one 1920x1080 screen and processes which only exit when told */
+
+BOOL
+AreFileApisANSI(void) {
+	return TRUE;
+}
+
+HANDLE
+CreateMutexW(LPVOID attrs, BOOL owner, LPCWSTR name) {
+	return (HANDLE)1;
+}
+
+BOOL
+EnumDisplayDevicesA(LPCSTR device, DWORD i, DISPLAY_DEVICE *dd, DWORD flags) {
+	return FALSE;
+}
+
+BOOL
+EnumDisplaySettingsA(LPCSTR device, DWORD mode, DEVMODE *dm) {
+	return FALSE;
+}
+
+BOOL
+GetExitCodeProcess(HANDLE h, LPDWORD code) {
+	*code = STILL_ACTIVE;
+	return TRUE;
+}
+
+short
+GetKeyState(int key) {
+	return 0;
+}
+
+DWORD
+GetLastError(void) {
+	return 0;
+}
+
+DWORD
+GetModuleFileNameA(HMODULE mod, LPSTR buf, DWORD n) {
+	snprintf(buf, n, "dwm-win32.exe");
+	return strlen(buf);
+}
+
+BOOL
+GetProcessTimes(HANDLE h, FILETIME *creation, FILETIME *exit, FILETIME *kernel, FILETIME *user) {
+	memset(creation, 0, sizeof *creation);
+	creation->dwLowDateTime = (DWORD)(uintptr_t)h;
+	return TRUE;
+}
+
+int
+GetSystemMetrics(int i) {
+	switch (i) {
+	case SM_CXVIRTUALSCREEN:
+		return 1920;
+	case SM_CYVIRTUALSCREEN:
+		return 1080;
+	default:
+		return 0;
+	}
+}
+
+DWORD
+GetTickCount(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int
+MessageBoxA(HWND hwnd, LPCSTR text, LPCSTR caption, UINT type) {
+	fprintf(stderr, "%s: %s\n", caption, text);
+	return 0;
+}
+
+int
+MessageBoxW(HWND hwnd, LPCWSTR text, LPCWSTR caption, UINT type) {
+	char s[1024];
+
+	if (wcstombs(s, text, sizeof s) == (size_t)-1)
+		snprintf(s, sizeof s, "(unprintable)");
+	s[sizeof s - 1] = '\0';
+	fprintf(stderr, "%s\n", s);
+	return 0;
+}
+
+int
+MultiByteToWideChar(UINT cp, DWORD flags, LPCSTR s, int n, LPWSTR ws, int wn) {
+	int i, len = n < 0 ? (int)strlen(s) + 1 : n;
+
+	if (!ws)
+		return len;
+	for (i = 0; i < len && i < wn; i++)
+		ws[i] = (unsigned char)s[i];
+	return i;
+}
+
+/* processes nobody started are app<pid>.exe */
+HANDLE
+OpenProcess(DWORD access, BOOL inherit, DWORD pid) {
+	wchar_t image[MAX_PATH];
+	unsigned int i;
+
+	fakecalls.openprocess++;
+	for (i = 0; i < nprocesses; i++)
+		if (processes[i].pid == pid && !processes[i].exited)
+			break;
+	if (i == nprocesses) {
+		swprintf(image, LENGTH(image), L"C:\\Program Files\\fake\\app%u.exe", (unsigned int)pid);
+		fakestartprocess(pid, image, false);
+		if (i == nprocesses)
+			return NULL;
+	}
+	return processes[i].denied ? NULL : (HANDLE)(uintptr_t)(i + 1);
+}
+
+void
+OutputDebugStringA(LPCSTR s) {
+}
+
+void
+OutputDebugStringW(LPCWSTR s) {
+}
+
+BOOL
+QueryFullProcessImageNameW(HANDLE h, DWORD flags, LPWSTR buf, LPDWORD n) {
+	uintptr_t i = (uintptr_t)h;
+	int len;
+
+	fakecalls.queryimage++;
+	if (i < 1 || i > nprocesses || (len = wcslen(processes[i - 1].image)) >= (int)*n)
+		return FALSE;
+	wcscpy(buf, processes[i - 1].image);
+	*n = len;
+	return TRUE;
+}
+
+BOOL
+QueryPerformanceCounter(LARGE_INTEGER *count) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	count->QuadPart = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	return TRUE;
+}
+
+BOOL
+QueryPerformanceFrequency(LARGE_INTEGER *freq) {
+	freq->QuadPart = 1000000000LL;
+	return TRUE;
+}
+
+BOOL
+SetProcessDPIAware(void) {
+	return TRUE;
+}
+
+BOOL
+SystemParametersInfoW(UINT action, UINT param, void *value, UINT flags) {
+	if (action != SPI_GETWORKAREA)
+		return FALSE;
+	*(RECT *)value = fakeworkarea;
+	return TRUE;
+}
+
+/* only process handles are waited for */
+DWORD
+WaitForSingleObject(HANDLE h, DWORD ms) {
+	uintptr_t i = (uintptr_t)h;
+
+	if (i < 1 || i > nprocesses)
+		return WAIT_FAILED;
+	return processes[i - 1].exited ? WAIT_OBJECT_0 : WAIT_TIMEOUT;
+}
+
+int
+WideCharToMultiByte(UINT cp, DWORD flags, LPCWSTR ws, int wn, LPSTR s, int n, LPCSTR def, BOOL *useddef) {
+	int i, len = wn < 0 ? (int)wcslen(ws) + 1 : wn;
+
+	if (!s)
+		return len;
+	for (i = 0; i < len && i < n; i++)
+		s[i] = ws[i] < 0x80 ? (char)ws[i] : '?';
+	return i;
+}
+
+/* windows.h extras */
+
+HRESULT
+DwmGetWindowAttribute(HWND hwnd, DWORD attr, void *value, DWORD size) {
+	FakeWindow *f = fakewindow(hwnd);
+
+	fakecalls.cloaked += attr == DWMWA_CLOAKED;
+	if (!f || attr != DWMWA_CLOAKED || size < sizeof(int))
+		return -1;
+	*(int *)value = f->cloaked;
+	return S_OK;
+}
+
+HINSTANCE
+ShellExecuteW(HWND hwnd, LPCWSTR op, LPCWSTR file, LPCWSTR params, LPCWSTR dir, int show) {
+	return NULL;
+}
+
+/* C runtime */
+
+int
+_vscwprintf(const wchar_t *format, va_list ap) {
+	static wchar_t buf[8192];
+	va_list aq;
+	int n;
+
+	va_copy(aq, ap);
+	n = vswprintf(buf, LENGTH(buf), format, aq);
+	va_end(aq);
+	return n;
+}
+
+int
+_wcsicmp(const wchar_t *a, const wchar_t *b) {
+	return wcscasecmp(a, b);
+}
+
+int
+gmtime_s(struct tm *tm, const time_t *t) {
+	return gmtime_r(t, tm) ? 0 : -1;
+}
+
+int
+localtime_s(struct tm *tm, const time_t *t) {
+	return localtime_r(t, tm) ? 0 : -1;
+}
+
+int
+wcscpy_s(wchar_t *dst, size_t n, const wchar_t *src) {
+	if (wcslen(src) >= n)
+		return -1;
+	wcscpy(dst, src);
+	return 0;
+}
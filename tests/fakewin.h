@@ -0,0 +1,53 @@
+/* A fake window system behind the Win32 API of win32/windows.h, for
+ * running the window manager on Linux. Windows are plain records the
+ * tests create, inspect and destroy. Posted messages, including the
+ * shell hook messages about top-level windows being created, shown,
+ * hidden or destroyed, queue up until fakepump() dispatches them, as
+ * the message loop would. So do the events for the WinEvent hooks, and
+ * the timers once fakesleep() let their time pass. */
+#include <stdbool.h>
+#include <windows.h>
+
+#define FAKEMAXWINDOWS 8192
+
+typedef struct {
+	bool used;
+	HWND parent, owner;
+	LONG style, exstyle;
+	wchar_t class[256], title[256];
+	bool cloaked;
+	DWORD pid;
+	int x, y, w, h;
+	WNDPROC proc;
+} FakeWindow;
+
+typedef struct {
+	unsigned int setwindowpos;  /* SetWindowPos, deferred moves not included */
+	unsigned int deferred;      /* moves handed to DeferWindowPos */
+	unsigned int commits;       /* successful EndDeferWindowPos */
+	unsigned int screendc;      /* GetWindowDC(NULL), drawing over the whole screen */
+	unsigned int gettext;       /* GetWindowTextW */
+	unsigned int getclass;      /* GetClassNameW */
+	unsigned int cloaked;       /* DwmGetWindowAttribute(DWMWA_CLOAKED) */
+	unsigned int processid;     /* GetWindowThreadProcessId */
+	unsigned int openprocess;   /* OpenProcess */
+	unsigned int queryimage;    /* QueryFullProcessImageNameW */
+} FakeCalls;
+
+extern FakeCalls fakecalls;
+extern RECT fakeworkarea;          /* SPI_GETWORKAREA, the screen is 1920x1080 */
+extern unsigned int fakefaildefer; /* DeferWindowPos fails on this call of a transaction, 0 never */
+extern bool fakefailend;           /* EndDeferWindowPos fails and moves nothing */
+
+HWND fakecreate(const wchar_t *class, const wchar_t *title, LONG style);
+HWND fakecreatechild(HWND parent, const wchar_t *class, const wchar_t *title, LONG style, LONG exstyle);
+void fakedestroy(HWND hwnd);
+void fakenexthandle(HWND hwnd);
+void fakeactivate(HWND hwnd);
+void fakesettitle(HWND hwnd, const wchar_t *title);
+void fakecloak(HWND hwnd, bool cloaked);
+void fakestartprocess(DWORD pid, const wchar_t *image, bool denied);
+void fakeexitprocess(DWORD pid);
+void fakepump(void);
+void fakesleep(unsigned int ms);
+FakeWindow *fakewindow(HWND hwnd);
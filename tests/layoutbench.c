@@ -0,0 +1,61 @@
+/* Throughput of the layouts in src/layout.c, how many times per second
+ * each one arranges n clients on a 2560x1440 screen and how long that
+ * takes per client. */
+#include <stdio.h>
+#include <time.h>
+
+#include "layout.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define MAXN 10000
+#define RUNTIME 0.2 /* seconds per layout and client count */
+
+static const struct {
+	const char *name;
+	LayoutFunc arrange;
+} layouts[] = {
+	{ "tile", tile },
+	{ "monocle", monocle },
+	{ "bstack", bstack },
+	{ "grid", grid },
+	{ "gaplessgrid", gaplessgrid },
+	{ "spiral", spiral },
+	{ "dwindle", dwindle },
+};
+
+static const unsigned int counts[] = { 1, 10, 100, 1000, MAXN };
+
+static int x[MAXN], y[MAXN], w[MAXN], h[MAXN];
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(void) {
+	LayoutParams p = { 0, 20, 2560, 1420, 0.55 * (1 << MFACTBITS) + 0.5, 20 };
+	LayoutRects r = { x, y, w, h };
+	unsigned int i, j, k, runs, batch;
+	double start, elapsed;
+
+	printf("%-12s %6s %14s %10s\n", "layout", "n", "arranges/s", "ns/client");
+	for (i = 0; i < LENGTH(layouts); i++) {
+		for (k = 0; k < LENGTH(counts); k++) {
+			runs = 0;
+			batch = 1 + 10000 / counts[k];
+			start = now();
+			do {
+				for (j = 0; j < batch; j++)
+					layouts[i].arrange(&p, counts[k], &r);
+				runs += batch;
+			} while ((elapsed = now() - start) < RUNTIME);
+			printf("%-12s %6u %14.0f %10.2f\n", layouts[i].name, counts[k], runs / elapsed,
+			       elapsed / runs / counts[k] * 1e9);
+		}
+	}
+	return 0;
+}
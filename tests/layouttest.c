@@ -0,0 +1,181 @@
+/* Tests for the layouts in src/layout.c. Each case runs one layout for a
+ * fixed work area and compares the rects it produces with known ones.
+ * Then every layout runs for 1 to MAXPROPN clients on a few work areas,
+ * and for RANDOMRUNS random client counts, screens, bar positions and
+ * mfact values. checklayout() has to find its rects inside the work
+ * area, not overlapping and, for the layouts which do so, covering it. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "layout.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define MFACT(f) ((int)((f) * (1 << MFACTBITS) + 0.5)) /* as arrange() converts it */
+#define MAXN 8
+#define MAXPROPN 1000
+#define RANDOMRUNS 10000
+#define BH 20 /* bar height */
+
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	const char *name;
+	LayoutFunc arrange;
+	LayoutParams p;
+	unsigned int n;
+	Rect want[MAXN];
+} Case;
+
+/* a 1920x1080 screen with the bar on top, and an odd sized area */
+#define SCREEN { 0, 20, 1920, 1060, MFACT(0.55), 20 }
+#define ODD    { 10, 0, 1001, 601, MFACT(0.5), 20 }
+
+static const Case cases[] = {
+	{ "tile, no clients", tile, SCREEN, 0, { { 0 } } },
+	{ "tile, one client", tile, SCREEN, 1, { { 0, 20, 1920, 1060 } } },
+	{ "tile", tile, SCREEN, 3, {
+		{ 0, 20, 1056, 1060 }, { 1056, 20, 864, 530 }, { 1056, 550, 864, 530 } } },
+	{ "tile, leftover pixels", tile, ODD, 4, {
+		{ 10, 0, 500, 601 }, { 510, 0, 501, 201 }, { 510, 201, 501, 200 }, { 510, 401, 501, 200 } } },
+	{ "tile, stack cells below minh pile up", tile, { 0, 20, 1920, 1060, MFACT(0.55), 600 }, 3, {
+		{ 0, 20, 1056, 1060 }, { 1056, 20, 864, 1060 }, { 1056, 20, 864, 1060 } } },
+	{ "monocle", monocle, SCREEN, 2, { { 0, 20, 1920, 1060 }, { 0, 20, 1920, 1060 } } },
+	{ "bstack", bstack, ODD, 3, {
+		{ 10, 0, 1001, 300 }, { 10, 300, 501, 301 }, { 511, 300, 500, 301 } } },
+	{ "bstack, one client", bstack, ODD, 1, { { 10, 0, 1001, 601 } } },
+	{ "grid", grid, ODD, 3, {
+		{ 10, 0, 501, 301 }, { 10, 301, 501, 300 }, { 511, 0, 500, 301 } } },
+	{ "grid, last column partly empty", grid, ODD, 5, {
+		{ 10, 0, 501, 201 }, { 10, 201, 501, 200 }, { 10, 401, 501, 200 },
+		{ 511, 0, 500, 201 }, { 511, 201, 500, 200 } } },
+	{ "gaplessgrid", gaplessgrid, ODD, 5, {
+		{ 10, 0, 501, 301 }, { 10, 301, 501, 300 },
+		{ 511, 0, 500, 201 }, { 511, 201, 500, 200 }, { 511, 401, 500, 200 } } },
+	{ "spiral", spiral, ODD, 4, {
+		{ 10, 0, 500, 601 }, { 510, 0, 501, 300 }, { 761, 300, 250, 301 }, { 510, 300, 251, 301 } } },
+	{ "dwindle", dwindle, ODD, 4, {
+		{ 10, 0, 500, 601 }, { 510, 0, 501, 300 }, { 510, 300, 250, 301 }, { 760, 300, 251, 301 } } },
+	{ "dwindle, one client", dwindle, ODD, 1, { { 10, 0, 1001, 601 } } },
+};
+
+enum { CoverAlways, CoverUnlessPiled, CoverNever };
+
+static const struct {
+	const char *name;
+	LayoutFunc arrange;
+	int cover;
+} layouts[] = {
+	{ "tile", tile, CoverUnlessPiled }, /* piles stack cells smaller than minh */
+	{ "monocle", monocle, CoverAlways },
+	{ "bstack", bstack, CoverUnlessPiled },
+	{ "grid", grid, CoverNever }, /* the last column may be partly empty */
+	{ "gaplessgrid", gaplessgrid, CoverAlways },
+	{ "spiral", spiral, CoverAlways },
+	{ "dwindle", dwindle, CoverAlways },
+};
+
+/* work areas, minh 0 never piles */
+static const LayoutParams areas[] = {
+	{ 0, 20, 1920, 1060, MFACT(0.55), 0 },
+	{ 0, 20, 1920, 1060, MFACT(0.55), 20 },
+	{ 10, 0, 1001, 601, MFACT(0.5), 0 },
+	{ -1280, -3, 1280, 1021, MFACT(0.9), 0 },
+};
+
+static unsigned int failures;
+
+static void
+runcase(const Case *c) {
+	int x[MAXN + 1], y[MAXN + 1], w[MAXN + 1], h[MAXN + 1];
+	LayoutRects r = { x, y, w, h };
+	unsigned int i;
+
+	/* the slot after the last client must stay untouched */
+	for (i = 0; i <= MAXN; i++)
+		x[i] = y[i] = w[i] = h[i] = -1;
+	c->arrange(&c->p, c->n, &r);
+	for (i = 0; i <= c->n && i <= MAXN; i++) {
+		if (i < c->n ? x[i] == c->want[i].x && y[i] == c->want[i].y && w[i] == c->want[i].w && h[i] == c->want[i].h
+		             : x[i] == -1 && y[i] == -1 && w[i] == -1 && h[i] == -1)
+			continue;
+		failures++;
+		if (i < c->n)
+			printf("%s: client %u at %d,%d %dx%d, expected %d,%d %dx%d\n", c->name, i,
+			       x[i], y[i], w[i], h[i], c->want[i].x, c->want[i].y, c->want[i].w, c->want[i].h);
+		else
+			printf("%s: wrote past the last client\n", c->name);
+	}
+}
+
+/* runs layout l for n clients and reports what checklayout() finds */
+static void
+checkproperties(unsigned int l, const LayoutParams *p, unsigned int n) {
+	static int x[MAXPROPN + 1], y[MAXPROPN + 1], w[MAXPROPN + 1], h[MAXPROPN + 1];
+	LayoutRects r = { x, y, w, h };
+	unsigned int bad;
+	const char *err;
+
+	x[n] = y[n] = w[n] = h[n] = -1;
+	layouts[l].arrange(p, n, &r);
+	if (x[n] != -1 || y[n] != -1 || w[n] != -1 || h[n] != -1) {
+		err = "wrote past the last client";
+		bad = n;
+	}
+	else if (!(err = checklayout(p, n, &r, layouts[l].cover == CoverAlways
+	                             || (layouts[l].cover == CoverUnlessPiled && !p->minh), &bad)))
+		return;
+	if (failures++ < 10)
+		printf("%s, %u clients on %d,%d %dx%d, mfact %d: %s at client %u\n", layouts[l].name, n,
+		       p->x, p->y, p->w, p->h, p->mfact, err, bad);
+}
+
+static int
+randint(int min, int max) {
+	return min + rand() % (max - min + 1);
+}
+
+/* a screen of up to 4k anywhere on the desktop with the bar at its top or
+ * bottom, mostly few clients but at times up to MAXPROPN */
+static void
+checkrandom(unsigned int l) {
+	LayoutParams p;
+	unsigned int i, n;
+	int sh;
+
+	for (i = 0; i < RANDOMRUNS; i++) {
+		p.x = randint(-3840, 3840);
+		p.y = randint(-2160, 2160);
+		p.w = randint(1, 3840);
+		sh = randint(BH + 1, 2160);
+		if (rand() % 2)
+			p.y += BH; /* bar on top */
+		p.h = sh - BH;
+		p.mfact = MFACT(randint(10, 90) / 100.0);
+		p.minh = rand() % 2 ? BH : 0;
+		n = rand() % 10 ? randint(1, 50) : randint(1, MAXPROPN);
+		checkproperties(l, &p, n);
+	}
+}
+
+int
+main(void) {
+	unsigned int i, j, n;
+
+	for (i = 0; i < LENGTH(cases); i++)
+		runcase(&cases[i]);
+	srand(1);
+	for (i = 0; i < LENGTH(layouts); i++) {
+		for (j = 0; j < LENGTH(areas); j++)
+			for (n = 1; n <= MAXPROPN; n++)
+				checkproperties(i, &areas[j], n);
+		checkrandom(i);
+	}
+	if (failures) {
+		printf("layouttest: %u failures\n", failures);
+		return 1;
+	}
+	printf("layouttest: ok\n");
+	return 0;
+}
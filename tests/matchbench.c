@@ -0,0 +1,324 @@
+/* Throughput of the rule matcher in src/match.c against the loops it
+ * replaced, on window titles and class names as they come from common
+ * applications. Every rule's substring used to be looked up with wcsstr,
+ * exact rules were substring rules as well. Matcher and loop have to find
+ * the same rules. Last come patterns which make backtracking matchers take
+ * exponential time, the DFAs have to stay linear in the title length. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#include "match.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define MAXRULES 1000
+#define MAXKEYS 10000
+#define NTITLES 256
+#define NCLASSES 256
+#define MAXTEXT 100000
+#define RUNTIME 0.2 /* seconds per timed loop */
+
+typedef struct {
+	wchar_t pattern[64];
+} Rule;
+
+/* applications users write rules for */
+static const wchar_t *apps[] = {
+	L"Mozilla Firefox", L"Visual Studio Code", L"Notepad", L"Outlook", L"Excel",
+	L"PowerPoint", L"File Explorer", L"Task Manager", L"Spotify", L"Slack",
+	L"Discord", L"Steam", L"Paint", L"Windows PowerShell", L"Command Prompt",
+	L"Settings", L"Calculator", L"Microsoft Teams", L"VLC media player", L"GIMP",
+};
+
+/* the other rules single out documents, projects and channels */
+static const wchar_t *words[] = {
+	L"report", L"project", L"channel", L"Budget ", L"Untitled ", L"Video ", L"folder",
+};
+
+static const wchar_t *templates[] = {
+	L"report%u.docx - Word",
+	L"Inbox (%u) - user@example.com - Outlook",
+	L"main.c - project%u - Visual Studio Code",
+	L"Video %u - YouTube \x2014 Mozilla Firefox",
+	L"C:\\Users\\user\\Documents\\folder%u",
+	L"Budget %u.xlsx - Excel",
+	L"#channel%u | Acme - Slack",
+	L"Untitled %u - Notepad",
+	L"Administrator: Windows PowerShell (%u)",
+	L"Task Manager",
+};
+
+/* window classes of common applications, the exact rules name others */
+static const wchar_t *classes[] = {
+	L"CabinetWClass", L"XLMAIN", L"OpusApp", L"PPTFrameClass", L"TaskManagerWindow",
+	L"Chrome_WidgetWin_1", L"MozillaWindowClass", L"Notepad", L"ConsoleWindowClass",
+	L"ApplicationFrameWindow", L"SunAwtFrame", L"Qt5QWindowIcon",
+};
+
+/* the runs of a in the titles trap backtracking matchers, b never comes */
+static const struct {
+	const wchar_t *pattern;
+	bool glob;
+} traps[] = {
+	{ L"a*a*a*a*a*a*a*a*a*a*a*a*b", false },
+	{ L"(a*)*b", false },
+	{ L"(a|aa)*b", false },
+	{ L"(a|a)*(a|a)*(a|a)*b", false },
+	{ L"a?a?a?a?a?a?a?a?a?a?a?a?aaaaaaaaaaaab", false },
+	{ L"*a*a*a*a*a*a*a*a*b", true },
+};
+
+static const unsigned int lengths[] = { 100, 1000, 10000, MAXTEXT };
+
+static Rule rules[MAXRULES], keys[MAXKEYS];
+static wchar_t titles[NTITLES][128], classnames[NCLASSES][64];
+static unsigned int failures;
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the rules as they were looked up before the matcher */
+static void
+loopsubstrings(unsigned int nrules, const wchar_t *title, unsigned int *set) {
+	unsigned int i;
+
+	for (i = 0; i < nrules; i++)
+		if (wcsstr(title, rules[i].pattern))
+			MATCHSET(set, i);
+}
+
+/* ns per title for nrules substring rules, matched by the matcher and by
+ * the loop */
+static void
+benchsubstrings(unsigned int nrules) {
+	unsigned int set[MAXRULES / MATCHBITS + 1], loopset[MAXRULES / MATCHBITS + 1];
+	unsigned int i, k, runs, found = 0;
+	double t, matcher, loop;
+	Matcher *m;
+
+	if (!(m = matchnew(0)))
+		exit(2);
+	for (i = 0; i < nrules; i++)
+		if (!matchadd(m, rules[i].pattern, i))
+			exit(2);
+	if (!matchcompile(m))
+		exit(2);
+
+	for (k = 0; k < NTITLES; k++) {
+		memset(set, 0, sizeof set);
+		memset(loopset, 0, sizeof loopset);
+		matchrun(m, titles[k], set);
+		loopsubstrings(nrules, titles[k], loopset);
+		if (memcmp(set, loopset, sizeof set) && failures++ < 10)
+			printf("%u rules: the matcher and the loop disagree on \"%ls\"\n", nrules, titles[k]);
+		for (i = 0; i < nrules; i++)
+			found += MATCHISSET(set, i) != 0;
+	}
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < NTITLES; k++) {
+			memset(set, 0, sizeof set);
+			matchrun(m, titles[k], set);
+		}
+		runs += NTITLES;
+	} while (now() - t < RUNTIME);
+	matcher = (now() - t) / runs;
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < NTITLES; k++) {
+			memset(set, 0, sizeof set);
+			loopsubstrings(nrules, titles[k], set);
+		}
+		runs += NTITLES;
+	} while (now() - t < RUNTIME);
+	loop = (now() - t) / runs;
+
+	printf("%8u %14.2f %12.0f %12.0f %8.1fx\n", nrules, (double)found / NTITLES,
+	       matcher * 1e9, loop * 1e9, loop / matcher);
+	matchfree(m);
+}
+
+/* what an exact rule means, for checking matchexact() */
+static void
+loopexact(unsigned int nkeys, const wchar_t *classname, unsigned int *set) {
+	unsigned int i;
+
+	for (i = 0; i < nkeys; i++)
+		if (!wcscmp(classname, keys[i].pattern))
+			MATCHSET(set, i);
+}
+
+/* ns per class name for nkeys exact rules, looked up in the hash table
+ * of matchexact() and, as they were before there were exact rules, as
+ * substrings by the matcher and by the wcsstr loop */
+static void
+benchexact(unsigned int nkeys) {
+	static unsigned int set[MAXKEYS / MATCHBITS + 1], loopset[MAXKEYS / MATCHBITS + 1];
+	unsigned int i, k, runs, found = 0;
+	double t, exact, substring, loop;
+	Matcher *m, *sm;
+
+	if (!(m = matchnew(0)) || !(sm = matchnew(0)))
+		exit(2);
+	for (i = 0; i < nkeys; i++)
+		if (!matchaddexact(m, keys[i].pattern, i) || !matchadd(sm, keys[i].pattern, i))
+			exit(2);
+	if (!matchcompile(m) || !matchcompile(sm))
+		exit(2);
+
+	for (k = 0; k < NCLASSES; k++) {
+		memset(set, 0, sizeof set);
+		memset(loopset, 0, sizeof loopset);
+		matchexact(m, classnames[k], set);
+		loopexact(nkeys, classnames[k], loopset);
+		if (memcmp(set, loopset, sizeof set) && failures++ < 10)
+			printf("%u keys: matchexact() and the loop disagree on \"%ls\"\n", nkeys, classnames[k]);
+		for (i = 0; i < nkeys; i++)
+			found += MATCHISSET(set, i) != 0;
+	}
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < NCLASSES; k++) {
+			memset(set, 0, (nkeys / MATCHBITS + 1) * sizeof *set);
+			matchexact(m, classnames[k], set);
+		}
+		runs += NCLASSES;
+	} while (now() - t < RUNTIME);
+	exact = (now() - t) / runs;
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < NCLASSES; k++) {
+			memset(set, 0, (nkeys / MATCHBITS + 1) * sizeof *set);
+			matchrun(sm, classnames[k], set);
+		}
+		runs += NCLASSES;
+	} while (now() - t < RUNTIME);
+	substring = (now() - t) / runs;
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < NCLASSES; k++) {
+			memset(set, 0, (nkeys / MATCHBITS + 1) * sizeof *set);
+			for (i = 0; i < nkeys; i++)
+				if (wcsstr(classnames[k], keys[i].pattern))
+					MATCHSET(set, i);
+		}
+		runs += NCLASSES;
+	} while (now() - t < RUNTIME);
+	loop = (now() - t) / runs;
+
+	printf("%8u %12.2f %10.0f %14.0f %10.0f\n", nkeys, (double)found / NCLASSES,
+	       exact * 1e9, substring * 1e9, loop * 1e9);
+	matchfree(m);
+	matchfree(sm);
+}
+
+/* ns per title character for a trap pattern on runs of a as long as
+ * lengths[], which stay the same as the titles grow */
+static void
+benchtrap(const wchar_t *pattern, bool glob) {
+	static wchar_t text[MAXTEXT + 1];
+	unsigned int set[1], k, runs;
+	double t, ns[LENGTH(lengths)];
+	Matcher *m;
+
+	if (!(m = matchnew(0)) || !(glob ? matchaddglob(m, pattern, 0) : matchaddregex(m, pattern, 0))
+	|| !matchcompile(m)) {
+		printf("%ls: not compiled\n", pattern);
+		failures++;
+		matchfree(m);
+		return;
+	}
+	printf("%-40ls", pattern);
+	for (k = 0; k < LENGTH(lengths); k++) {
+		wmemset(text, L'a', lengths[k]);
+		text[lengths[k]] = L'\0';
+		runs = 0;
+		set[0] = 0;
+		t = now();
+		do {
+			if (glob)
+				matchexact(m, text, set);
+			else
+				matchrun(m, text, set);
+			runs++;
+		} while (now() - t < RUNTIME);
+		ns[k] = (now() - t) / runs / lengths[k] * 1e9;
+		printf(" %10.2f", ns[k]);
+		if (set[0] && failures++ < 10)
+			printf("\n%ls: matched %u times a\n", pattern, lengths[k]);
+	}
+	printf("\n");
+	/* the time per character may not grow with the length, allowing for noise */
+	if (ns[LENGTH(lengths) - 1] > 4 * ns[1]) {
+		printf("%ls: %.2f ns per character on %u characters, %.2f on %u\n", pattern,
+		       ns[LENGTH(lengths) - 1], lengths[LENGTH(lengths) - 1], ns[1], lengths[1]);
+		failures++;
+	}
+	matchfree(m);
+}
+
+int
+main(void) {
+	unsigned int i;
+
+	srand(1);
+	for (i = 0; i < MAXRULES; i++) {
+		if (i < LENGTH(apps))
+			wcscpy(rules[i].pattern, apps[i]);
+		else
+			swprintf(rules[i].pattern, LENGTH(rules[i].pattern), L"%ls%u",
+			         words[i % LENGTH(words)], rand() % 2000);
+	}
+	for (i = 0; i < NTITLES; i++)
+		swprintf(titles[i], LENGTH(titles[i]), templates[i % LENGTH(templates)], rand() % 2000);
+	/* half of the class names looked up have a rule */
+	for (i = 0; i < MAXKEYS; i++)
+		swprintf(keys[i].pattern, LENGTH(keys[i].pattern), L"%ls.%u", classes[i % LENGTH(classes)], i);
+	for (i = 0; i < NCLASSES; i++) {
+		if (rand() % 2)
+			wcscpy(classnames[i], keys[rand() % 100].pattern);
+		else
+			swprintf(classnames[i], LENGTH(classnames[i]), L"%ls", classes[i % LENGTH(classes)]);
+	}
+
+	printf("%8s %14s %12s %12s %9s\n", "rules", "matches/title", "ns matcher", "ns wcsstr", "speedup");
+	benchsubstrings(10);
+	benchsubstrings(100);
+	benchsubstrings(MAXRULES);
+
+	printf("\n%8s %12s %10s %14s %10s\n", "keys", "matches/key", "ns exact", "ns substring", "ns wcsstr");
+	benchexact(100);
+	benchexact(1000);
+	benchexact(MAXKEYS);
+
+	printf("\n%-40s", "ns/char on a runs of");
+	for (i = 0; i < LENGTH(lengths); i++)
+		printf(" %10u", lengths[i]);
+	printf("\n");
+	for (i = 0; i < LENGTH(traps); i++)
+		benchtrap(traps[i].pattern, traps[i].glob);
+
+	if (failures) {
+		printf("matchbench: %u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+/* Checks src/match.c against the plain loops it replaced: every rule's
+ * substring is looked up with wcsstr, every exact key compared with
+ * wcscmp, or wcscasecmp when the matcher folds case. Rules and texts are
+ * random strings over a tiny alphabet so that they collide often. */
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "match.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define MAXRULES 300
+#define MAXLEN 24
+
+typedef struct {
+	wchar_t pattern[MAXLEN + 1];
+	int exact;
+} Rule;
+
+static const wchar_t alphabet[] = L"abcAB\x00e9\x00c9\x4e2d";
+static Rule rules[MAXRULES];
+static unsigned int failures;
+
+static void
+randstr(wchar_t *s, unsigned int maxlen, unsigned int nalpha) {
+	unsigned int i, n = rand() % (maxlen + 1);
+
+	for (i = 0; i < n; i++)
+		s[i] = alphabet[rand() % nalpha];
+	s[n] = L'\0';
+}
+
+static int
+expected(const Rule *r, const wchar_t *text, unsigned int flags) {
+	if (!r->exact)
+		return wcsstr(text, r->pattern) != NULL;
+	if (flags & MatchFoldCase)
+		return !wcscasecmp(text, r->pattern);
+	return !wcscmp(text, r->pattern);
+}
+
+static void
+check(unsigned int round, unsigned int nrules, unsigned int flags, const wchar_t *text, const unsigned int *set) {
+	unsigned int i;
+
+	for (i = 0; i < nrules; i++) {
+		if (!!MATCHISSET(set, i) == expected(&rules[i], text, flags))
+			continue;
+		if (failures++ < 10)
+			printf("round %u: %s rule %u \"%ls\" %s \"%ls\"\n", round,
+			       rules[i].exact ? "exact" : "substring", i, rules[i].pattern,
+			       MATCHISSET(set, i) ? "wrongly matched" : "missed", text);
+	}
+	for (; i < MAXRULES; i++)
+		if (MATCHISSET(set, i) && failures++ < 10)
+			printf("round %u: unknown rule %u matched \"%ls\"\n", round, i, text);
+}
+
+int
+main(void) {
+	unsigned int set[MAXRULES / MATCHBITS + 1];
+	unsigned int round, nrules, nalpha, flags, i, k;
+	wchar_t text[MAXLEN * 2 + 1];
+	Matcher *m;
+
+	/* towlower() only folds beyond ASCII in a Unicode locale, as on Windows */
+	setlocale(LC_CTYPE, "C.UTF-8");
+	srand(1);
+	for (round = 0; round < 2000; round++) {
+		nrules = 1 + rand() % MAXRULES;
+		nalpha = 1 + rand() % (LENGTH(alphabet) - 1);
+		flags = rand() % 2 ? MatchFoldCase : 0;
+		if (!(m = matchnew(flags)))
+			return 2;
+		for (i = 0; i < nrules; i++) {
+			rules[i].exact = rand() % 3 == 0;
+			randstr(rules[i].pattern, 1 + rand() % 5, nalpha);
+			if (!(rules[i].exact ? matchaddexact(m, rules[i].pattern, i) : matchadd(m, rules[i].pattern, i)))
+				return 2;
+		}
+		if (!matchcompile(m))
+			return 2;
+		for (k = 0; k < 50; k++) {
+			/* whole keys now and then, else exact rules would hardly ever match */
+			if (k % 5 == 0)
+				wcscpy(text, rules[rand() % nrules].pattern);
+			else
+				randstr(text, MAXLEN * 2, nalpha);
+			memset(set, 0, sizeof set);
+			matchrun(m, text, set);
+			matchexact(m, text, set);
+			check(round, nrules, flags, text, set);
+		}
+		matchfree(m);
+	}
+	if (failures) {
+		printf("matchtest: %u mismatches\n", failures);
+		return 1;
+	}
+	printf("matchtest: ok\n");
+	return 0;
+}
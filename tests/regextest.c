@@ -0,0 +1,202 @@
+/* Fuzzes the glob and regex DFAs of src/match.c against the C library:
+ * random regexes are compared with regcomp()/regexec() as POSIX extended
+ * regular expressions, random globs with fnmatch(). Patterns regcomp()
+ * rejects are skipped, as are those exceeding the DFA size limit. All
+ * others have to agree on every text. */
+#define _GNU_SOURCE /* FNM_CASEFOLD */
+#include <fnmatch.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "match.h"
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define MAXPATTERN 256
+
+typedef struct {
+	char our[MAXPATTERN], posix[MAXPATTERN]; /* the same pattern in both syntaxes */
+	unsigned int len, posixlen;
+} Pattern;
+
+static const char textchars[] = "abAB0_ ";
+static unsigned int failures, compared, skipped, toobig;
+
+static void
+put(Pattern *p, const char *our, const char *posix) {
+	size_t n = strlen(our), m = strlen(posix);
+
+	if (p->len + n >= MAXPATTERN || p->posixlen + m >= MAXPATTERN)
+		return;
+	memcpy(p->our + p->len, our, n + 1);
+	memcpy(p->posix + p->posixlen, posix, m + 1);
+	p->len += n;
+	p->posixlen += m;
+}
+
+static bool genalt(Pattern *p, unsigned int depth);
+
+/* returns whether an anchor was generated */
+static bool
+genpiece(Pattern *p, unsigned int depth) {
+	static const char *atoms[][2] = {
+		{ "a", "a" }, { "b", "b" }, { "A", "A" }, { "B", "B" }, { "0", "0" },
+		{ ".", "." }, { "[ab]", "[ab]" }, { "[^a]", "[^a]" }, { "[a-b]", "[a-b]" },
+		{ "[^ 0]", "[^ 0]" }, { "\\.", "\\." }, { "\\*", "\\*" },
+		{ "\\d", "[0-9]" }, { "\\w", "[0-9A-Za-z_]" }, { "\\s", "[ \t-\r]" },
+	};
+	static const char *quantifiers[] = { "*", "+", "?" };
+	unsigned int r = rand() % 20;
+	bool anchored = false;
+
+	if (r < 2) {
+		/* POSIX leaves repeated anchors undefined */
+		put(p, r ? "^" : "$", r ? "^" : "$");
+		return true;
+	}
+	if (r < 5 && depth < 2) {
+		put(p, "(", "(");
+		anchored = genalt(p, depth + 1);
+		put(p, ")", ")");
+	}
+	else {
+		r = rand() % LENGTH(atoms);
+		put(p, atoms[r][0], atoms[r][1]);
+	}
+	/* glibc gets anchors in repeated groups wrong, (^a*[^a])+b matches "a 0b" */
+	if (!anchored && rand() % 4 == 0) {
+		r = rand() % LENGTH(quantifiers);
+		put(p, quantifiers[r], quantifiers[r]);
+	}
+	return anchored;
+}
+
+static bool
+genalt(Pattern *p, unsigned int depth) {
+	unsigned int i, n;
+	bool anchored = false;
+
+	for (;;) {
+		for (i = 0, n = 1 + rand() % 3; i < n; i++)
+			anchored |= genpiece(p, depth);
+		if (rand() % 3)
+			return anchored;
+		put(p, "|", "|");
+	}
+}
+
+static void
+genglob(Pattern *p) {
+	static const char *parts[] = { "a", "b", "A", ".", "*", "?", "[ab]", "[!a]", "[a-b]" };
+	unsigned int i, n = rand() % 7;
+
+	for (i = 0; i < n; i++)
+		put(p, parts[rand() % LENGTH(parts)], "");
+}
+
+static void
+gentext(char *s, wchar_t *w, unsigned int maxlen) {
+	unsigned int i, n = rand() % (maxlen + 1);
+
+	for (i = 0; i < n; i++)
+		w[i] = s[i] = textchars[rand() % (LENGTH(textchars) - 1)];
+	w[n] = s[n] = '\0';
+}
+
+static void
+widen(wchar_t *w, const char *s) {
+	while ((*w++ = (unsigned char)*s++));
+}
+
+static void
+report(const char *kind, unsigned int flags, const char *pattern, const char *text, int want) {
+	if (failures++ < 10)
+		printf("%s \"%s\"%s on \"%s\": expected %s\n", kind, pattern,
+		       flags & MatchFoldCase ? " ignoring case" : "", text, want ? "a match" : "none");
+}
+
+static void
+fuzzregex(unsigned int flags) {
+	Pattern p = { 0 };
+	wchar_t wpattern[MAXPATTERN], wtext[16];
+	unsigned int set[1], k;
+	char text[16];
+	regex_t re;
+	Matcher *m;
+	int want;
+
+	genalt(&p, 0);
+	widen(wpattern, p.our);
+	if (regcomp(&re, p.posix, REG_EXTENDED | REG_NOSUB | (flags & MatchFoldCase ? REG_ICASE : 0))) {
+		skipped++;
+		return;
+	}
+	if (!(m = matchnew(flags)))
+		exit(2);
+	if (!matchaddregex(m, wpattern, 0) || !matchcompile(m)) {
+		toobig++;
+		matchfree(m);
+		regfree(&re);
+		return;
+	}
+	for (k = 0; k < 20; k++) {
+		gentext(text, wtext, 10);
+		set[0] = 0;
+		matchrun(m, wtext, set);
+		want = !regexec(&re, text, 0, NULL, 0);
+		if (!!MATCHISSET(set, 0) != want)
+			report("regex", flags, p.our, text, want);
+		compared++;
+	}
+	matchfree(m);
+	regfree(&re);
+}
+
+static void
+fuzzglob(unsigned int flags) {
+	Pattern p = { 0 };
+	wchar_t wpattern[MAXPATTERN], wtext[16];
+	unsigned int set[1], k;
+	char text[16];
+	Matcher *m;
+	int want;
+
+	genglob(&p);
+	widen(wpattern, p.our);
+	if (!(m = matchnew(flags)) || !matchaddglob(m, wpattern, 0) || !matchcompile(m)) {
+		printf("glob \"%s\" rejected\n", p.our);
+		failures++;
+		matchfree(m);
+		return;
+	}
+	for (k = 0; k < 20; k++) {
+		gentext(text, wtext, 6);
+		set[0] = 0;
+		matchexact(m, wtext, set);
+		want = !fnmatch(p.our, text, FNM_NOESCAPE | (flags & MatchFoldCase ? FNM_CASEFOLD : 0));
+		if (!!MATCHISSET(set, 0) != want)
+			report("glob", flags, p.our, text, want);
+		compared++;
+	}
+	matchfree(m);
+}
+
+int
+main(void) {
+	unsigned int i;
+
+	srand(1);
+	for (i = 0; i < 20000; i++) {
+		fuzzregex(i % 2 ? MatchFoldCase : 0);
+		fuzzglob(i % 2 ? MatchFoldCase : 0);
+	}
+	if (failures) {
+		printf("regextest: %u mismatches\n", failures);
+		return 1;
+	}
+	printf("regextest: ok, %u texts compared, %u patterns skipped\n", compared, skipped + toobig);
+	return 0;
+}
@@ -0,0 +1,6 @@
+/* See windows.h */
+#include <windows.h>
+
+#define DWMWA_CLOAKED 14
+
+HRESULT DwmGetWindowAttribute(HWND hwnd, DWORD attr, void *value, DWORD size);
@@ -0,0 +1,4 @@
+/* See windows.h */
+#include <windows.h>
+
+HINSTANCE ShellExecuteW(HWND hwnd, LPCWSTR op, LPCWSTR file, LPCWSTR params, LPCWSTR dir, int show);
@@ -0,0 +1,391 @@
+/* Just enough of the Win32 API to build dwm-win32 on Linux. The
+ * functions are implemented by the fake window system in ../fakewin.c,
+ * only the parts the window manager uses exist. */
+#ifndef FAKE_WINDOWS_H
+#define FAKE_WINDOWS_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT            0x0A00
+#endif
+
+#define CALLBACK
+#define WINAPI
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef int64_t LONGLONG;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef intptr_t LRESULT;
+typedef uintptr_t UINT_PTR;
+typedef LONG HRESULT;
+typedef DWORD COLORREF;
+typedef DWORD *LPDWORD;
+typedef void *LPVOID;
+typedef wchar_t WCHAR;
+typedef WCHAR *LPWSTR;
+typedef const WCHAR *LPCWSTR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+
+typedef void *HANDLE;
+typedef struct HWND__ *HWND;
+typedef struct HDC__ *HDC;
+typedef struct HINSTANCE__ *HINSTANCE;
+typedef struct HWINEVENTHOOK__ *HWINEVENTHOOK;
+typedef HINSTANCE HMODULE;
+typedef void *HGDIOBJ;
+typedef HGDIOBJ HBRUSH, HFONT, HPEN;
+typedef void *HICON;
+typedef void *HCURSOR;
+typedef void *HMENU;
+typedef void *HDWP;
+
+typedef struct { LONG left, top, right, bottom; } RECT;
+typedef struct { LONG x, y; } POINT;
+typedef struct { short x, y; } POINTS;
+typedef struct { LONG cx, cy; } SIZE;
+typedef struct { DWORD dwLowDateTime, dwHighDateTime; } FILETIME;
+typedef union { struct { DWORD LowPart; LONG HighPart; } u; LONGLONG QuadPart; } LARGE_INTEGER;
+
+typedef struct {
+	HWND hwnd;
+	UINT message;
+	WPARAM wParam;
+	LPARAM lParam;
+	DWORD time;
+	POINT pt;
+} MSG;
+
+typedef struct {
+	HDC hdc;
+	BOOL fErase;
+	RECT rcPaint;
+} PAINTSTRUCT;
+
+typedef struct {
+	DWORD cbSize;
+	RECT rcWindow, rcClient;
+	DWORD dwStyle, dwExStyle;
+} WINDOWINFO;
+
+typedef struct {
+	UINT length, flags, showCmd;
+	POINT ptMinPosition, ptMaxPosition;
+	RECT rcNormalPosition;
+} WINDOWPLACEMENT;
+
+typedef LRESULT (CALLBACK *WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+typedef BOOL (CALLBACK *WNDENUMPROC)(HWND, LPARAM);
+typedef void (CALLBACK *WINEVENTPROC)(HWINEVENTHOOK, DWORD, HWND, LONG, LONG, DWORD, DWORD);
+typedef void (CALLBACK *TIMERPROC)(HWND, UINT, UINT_PTR, DWORD);
+
+typedef struct {
+	UINT cbSize, style;
+	WNDPROC lpfnWndProc;
+	int cbClsExtra, cbWndExtra;
+	HINSTANCE hInstance;
+	HICON hIcon;
+	HCURSOR hCursor;
+	HBRUSH hbrBackground;
+	LPCWSTR lpszMenuName, lpszClassName;
+	HICON hIconSm;
+} WNDCLASSEXW;
+
+typedef struct {
+	UINT style;
+	WNDPROC lpfnWndProc;
+	int cbClsExtra, cbWndExtra;
+	HINSTANCE hInstance;
+	HICON hIcon;
+	HCURSOR hCursor;
+	HBRUSH hbrBackground;
+	LPCWSTR lpszMenuName, lpszClassName;
+} WNDCLASSW;
+
+typedef struct {
+	DWORD cb;
+	char DeviceName[32], DeviceString[128];
+	DWORD StateFlags;
+	char DeviceID[128], DeviceKey[128];
+} DISPLAY_DEVICE;
+
+typedef struct {
+	WORD dmSize, dmDriverExtra;
+	short dmScale;
+	POINT dmPosition;
+	DWORD dmPelsWidth, dmPelsHeight;
+} DEVMODE;
+
+#define TRUE                    1
+#define FALSE                   0
+#define S_OK                    0
+#define MAX_PATH                260
+#define INFINITE                0xFFFFFFFF
+
+#define CP_ACP                  0
+#define CP_OEMCP                1
+#define CP_UTF8                 65001
+
+#define ERROR_ACCESS_DENIED     5
+#define ERROR_ALREADY_EXISTS    183
+
+#define WAIT_OBJECT_0           0
+#define WAIT_TIMEOUT            258
+#define WAIT_FAILED             0xFFFFFFFF
+#define STILL_ACTIVE            259
+#define SYNCHRONIZE             0x00100000
+#define PROCESS_QUERY_INFORMATION 0x0400
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+
+#define WS_POPUP                ((LONG)0x80000000)
+#define WS_CHILD                0x40000000
+#define WS_MINIMIZE             0x20000000
+#define WS_VISIBLE              0x10000000
+#define WS_DISABLED             0x08000000
+#define WS_CLIPSIBLINGS         0x04000000
+#define WS_CLIPCHILDREN         0x02000000
+#define WS_MAXIMIZE             0x01000000
+#define WS_CAPTION              0x00C00000
+#define WS_BORDER               0x00800000
+#define WS_THICKFRAME           0x00040000
+#define WS_SIZEBOX              WS_THICKFRAME
+#define WS_MINIMIZEBOX          0x00020000
+#define WS_MAXIMIZEBOX          0x00010000
+#define WS_OVERLAPPEDWINDOW     (WS_CAPTION | WS_THICKFRAME | WS_MINIMIZEBOX | WS_MAXIMIZEBOX)
+
+#define WS_EX_NOACTIVATE        0x08000000
+#define WS_EX_APPWINDOW         0x00040000
+#define WS_EX_CLIENTEDGE        0x00000200
+#define WS_EX_WINDOWEDGE        0x00000100
+#define WS_EX_TOOLWINDOW        0x00000080
+
+#define GWL_STYLE               (-16)
+#define GWL_EXSTYLE             (-20)
+#define GW_OWNER                4
+
+#define HWND_TOP                ((HWND)0)
+#define HWND_TOPMOST            ((HWND)-1)
+#define HWND_NOTOPMOST          ((HWND)-2)
+#define HWND_MESSAGE            ((HWND)-3)
+
+#define SWP_NOSIZE              0x0001
+#define SWP_NOMOVE              0x0002
+#define SWP_NOZORDER            0x0004
+#define SWP_NOACTIVATE          0x0010
+#define SWP_FRAMECHANGED        0x0020
+#define SWP_SHOWWINDOW          0x0040
+#define SWP_HIDEWINDOW          0x0080
+#define SWP_NOOWNERZORDER       0x0200
+#define SWP_NOSENDCHANGING      0x0400
+
+#define SW_HIDE                 0
+#define SW_SHOW                 5
+#define SW_RESTORE              9
+#define SW_SHOWDEFAULT          10
+
+#define WM_CREATE               0x0001
+#define WM_DESTROY              0x0002
+#define WM_PAINT                0x000F
+#define WM_CLOSE                0x0010
+#define WM_QUIT                 0x0012
+#define WM_DISPLAYCHANGE        0x007E
+#define WM_SYSCOMMAND           0x0112
+#define WM_TIMER                0x0113
+#define WM_LBUTTONDOWN          0x0201
+#define WM_RBUTTONDOWN          0x0204
+#define WM_MBUTTONDOWN          0x0207
+#define WM_HOTKEY               0x0312
+#define WM_USER                 0x0400
+#define WM_APP                  0x8000
+
+#define SC_MINIMIZE             0xF020
+#define SC_MAXIMIZE             0xF030
+
+#define PM_NOREMOVE             0
+#define PM_REMOVE               1
+
+#define HSHELL_WINDOWCREATED    1
+#define HSHELL_WINDOWDESTROYED  2
+#define HSHELL_WINDOWACTIVATED  4
+
+#define WINEVENT_OUTOFCONTEXT   0
+#define OBJID_WINDOW            0
+#define CHILDID_SELF            0
+#define EVENT_OBJECT_DESTROY    0x8001
+#define EVENT_OBJECT_SHOW       0x8002
+#define EVENT_OBJECT_HIDE       0x8003
+#define EVENT_OBJECT_LOCATIONCHANGE 0x800B
+#define EVENT_OBJECT_NAMECHANGE 0x800C
+
+#define SM_XVIRTUALSCREEN       76
+#define SM_YVIRTUALSCREEN       77
+#define SM_CXVIRTUALSCREEN      78
+#define SM_CYVIRTUALSCREEN      79
+#define SPI_GETWORKAREA         0x0030
+
+#define COLOR_ACTIVEBORDER      10
+#define COLOR_INACTIVEBORDER    11
+#define SYSTEM_FONT             13
+#define PS_SOLID                0
+#define TRANSPARENT             1
+#define DT_CENTER               0x0001
+#define DT_VCENTER              0x0004
+#define DT_SINGLELINE           0x0020
+#define IDC_ARROW               ((LPCWSTR)32512)
+
+#define MB_OK                   0x00000000
+#define MB_ICONERROR            0x00000010
+#define MB_SETFOREGROUND        0x00010000
+
+#define MOD_ALT                 0x0001
+#define MOD_CONTROL             0x0002
+#define MOD_SHIFT               0x0004
+#define VK_TAB                  0x09
+#define VK_RETURN               0x0D
+#define VK_SHIFT                0x10
+#define VK_MENU                 0x12
+#define VK_SPACE                0x20
+
+#define DISPLAY_DEVICE_ACTIVE   0x00000001
+#define ENUM_CURRENT_SETTINGS   ((DWORD)-1)
+
+#define RGB(r, g, b)            ((COLORREF)((BYTE)(r) | (WORD)(BYTE)(g) << 8 | (DWORD)(BYTE)(b) << 16))
+#define MAKEPOINTS(l)           (*(POINTS *)&(l))
+
+#define DefWindowProc           DefWindowProcW
+#define DispatchMessage         DispatchMessageW
+#define EnumDisplayDevices      EnumDisplayDevicesA
+#define EnumDisplaySettings     EnumDisplaySettingsA
+#define GetMessage              GetMessageW
+#define GetModuleFileName       GetModuleFileNameA
+#define GetWindowLong           GetWindowLongW
+#define GetWindowTextLength     GetWindowTextLengthW
+#define LoadCursor              LoadCursorW
+#define MessageBox              MessageBoxA
+#define OutputDebugString       OutputDebugStringA
+#define PeekMessage             PeekMessageW
+#define PostMessage             PostMessageW
+#define SetWindowLong           SetWindowLongW
+#define SystemParametersInfo    SystemParametersInfoW
+
+/* windows */
+BOOL CloseHandle(HANDLE h);
+HWND CreateWindowExW(DWORD exstyle, LPCWSTR class, LPCWSTR title, DWORD style, int x, int y, int w, int h, HWND parent, HMENU menu, HINSTANCE inst, LPVOID param);
+LRESULT DefWindowProcW(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+BOOL DestroyWindow(HWND hwnd);
+BOOL EnumChildWindows(HWND parent, WNDENUMPROC f, LPARAM lParam);
+BOOL EnumWindows(WNDENUMPROC f, LPARAM lParam);
+HWND FindWindowW(LPCWSTR class, LPCWSTR title);
+int GetClassNameW(HWND hwnd, LPWSTR buf, int n);
+HWND GetDesktopWindow(void);
+HWND GetForegroundWindow(void);
+HWND GetParent(HWND hwnd);
+HWND GetWindow(HWND hwnd, UINT cmd);
+BOOL GetWindowInfo(HWND hwnd, WINDOWINFO *wi);
+LONG GetWindowLongW(HWND hwnd, int index);
+int GetWindowTextLengthW(HWND hwnd);
+int GetWindowTextW(HWND hwnd, LPWSTR buf, int n);
+DWORD GetWindowThreadProcessId(HWND hwnd, LPDWORD pid);
+BOOL IsIconic(HWND hwnd);
+BOOL IsWindow(HWND hwnd);
+BOOL IsWindowVisible(HWND hwnd);
+WORD RegisterClassExW(const WNDCLASSEXW *wc);
+WORD RegisterClassW(const WNDCLASSW *wc);
+BOOL SetForegroundWindow(HWND hwnd);
+LONG SetWindowLongW(HWND hwnd, int index, LONG value);
+BOOL SetWindowPlacement(HWND hwnd, const WINDOWPLACEMENT *wp);
+BOOL ShowWindow(HWND hwnd, int cmd);
+
+/* moving windows */
+HDWP BeginDeferWindowPos(int n);
+HDWP DeferWindowPos(HDWP hdwp, HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags);
+BOOL EndDeferWindowPos(HDWP hdwp);
+BOOL SetWindowPos(HWND hwnd, HWND after, int x, int y, int w, int h, UINT flags);
+
+/* messages and events */
+BOOL DeregisterShellHookWindow(HWND hwnd);
+LRESULT DispatchMessageW(const MSG *msg);
+BOOL GetMessageW(MSG *msg, HWND hwnd, UINT min, UINT max);
+BOOL KillTimer(HWND hwnd, UINT_PTR id);
+BOOL PeekMessageW(MSG *msg, HWND hwnd, UINT min, UINT max, UINT remove);
+BOOL PostMessageW(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+void PostQuitMessage(int code);
+BOOL RegisterHotKey(HWND hwnd, int id, UINT mod, UINT key);
+BOOL RegisterShellHookWindow(HWND hwnd);
+UINT RegisterWindowMessageW(LPCWSTR name);
+LRESULT SendMessageA(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+UINT_PTR SetTimer(HWND hwnd, UINT_PTR id, UINT ms, TIMERPROC f);
+HWINEVENTHOOK SetWinEventHook(DWORD min, DWORD max, HMODULE mod, WINEVENTPROC f, DWORD pid, DWORD tid, DWORD flags);
+BOOL TranslateMessage(const MSG *msg);
+BOOL UnhookWinEvent(HWINEVENTHOOK hook);
+BOOL UnregisterHotKey(HWND hwnd, int id);
+
+/* drawing */
+HDC BeginPaint(HWND hwnd, PAINTSTRUCT *ps);
+HBRUSH CreateSolidBrush(COLORREF col);
+HFONT CreateFontW(int h, int w, int esc, int orient, int weight, DWORD italic, DWORD underline, DWORD strikeout, DWORD charset, DWORD precision, DWORD clip, DWORD quality, DWORD pitch, LPCWSTR face);
+HPEN CreatePen(int style, int w, COLORREF col);
+BOOL DeleteObject(HGDIOBJ obj);
+int DrawTextW(HDC hdc, LPCWSTR s, int n, RECT *r, UINT format);
+BOOL EndPaint(HWND hwnd, const PAINTSTRUCT *ps);
+int FillRect(HDC hdc, const RECT *r, HBRUSH brush);
+HGDIOBJ GetStockObject(int i);
+DWORD GetSysColor(int i);
+BOOL GetTextExtentPoint32W(HDC hdc, LPCWSTR s, int n, SIZE *size);
+HDC GetWindowDC(HWND hwnd);
+BOOL LineTo(HDC hdc, int x, int y);
+HCURSOR LoadCursorW(HINSTANCE inst, LPCWSTR name);
+BOOL MoveToEx(HDC hdc, int x, int y, POINT *p);
+int ReleaseDC(HWND hwnd, HDC hdc);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj);
+int SetBkMode(HDC hdc, int mode);
+BOOL SetSysColors(int n, const int *elements, const COLORREF *cols);
+COLORREF SetTextColor(HDC hdc, COLORREF col);
+
+/* system */
+BOOL AreFileApisANSI(void);
+HANDLE CreateMutexW(LPVOID attrs, BOOL owner, LPCWSTR name);
+BOOL EnumDisplayDevicesA(LPCSTR device, DWORD i, DISPLAY_DEVICE *dd, DWORD flags);
+BOOL EnumDisplaySettingsA(LPCSTR device, DWORD mode, DEVMODE *dm);
+BOOL GetExitCodeProcess(HANDLE h, LPDWORD code);
+short GetKeyState(int key);
+DWORD GetLastError(void);
+DWORD GetModuleFileNameA(HMODULE mod, LPSTR buf, DWORD n);
+BOOL GetProcessTimes(HANDLE h, FILETIME *creation, FILETIME *exit, FILETIME *kernel, FILETIME *user);
+int GetSystemMetrics(int i);
+DWORD GetTickCount(void);
+int MessageBoxA(HWND hwnd, LPCSTR text, LPCSTR caption, UINT type);
+int MessageBoxW(HWND hwnd, LPCWSTR text, LPCWSTR caption, UINT type);
+int MultiByteToWideChar(UINT cp, DWORD flags, LPCSTR s, int n, LPWSTR ws, int wn);
+HANDLE OpenProcess(DWORD access, BOOL inherit, DWORD pid);
+void OutputDebugStringA(LPCSTR s);
+void OutputDebugStringW(LPCWSTR s);
+BOOL QueryFullProcessImageNameW(HANDLE h, DWORD flags, LPWSTR buf, LPDWORD n);
+BOOL QueryPerformanceCounter(LARGE_INTEGER *count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER *freq);
+BOOL SetProcessDPIAware(void);
+BOOL SystemParametersInfoW(UINT action, UINT param, void *value, UINT flags);
+DWORD WaitForSingleObject(HANDLE h, DWORD ms);
+int WideCharToMultiByte(UINT cp, DWORD flags, LPCWSTR ws, int wn, LPSTR s, int n, LPCSTR def, BOOL *useddef);
+
+/* C runtime */
+int _vscwprintf(const wchar_t *format, va_list ap);
+int _wcsicmp(const wchar_t *a, const wchar_t *b);
+int gmtime_s(struct tm *tm, const time_t *t);
+int localtime_s(struct tm *tm, const time_t *t);
+int wcscpy_s(wchar_t *dst, size_t n, const wchar_t *src);
+
+#endif
@@ -0,0 +1,701 @@
+/* Benchmarks the window manager running on the fake window system of
+ * fakewin.c. Window moves are SetWindowPos calls plus the moves deferred
+ * into a DeferWindowPos transaction, each one costs the real system a
+ * repaint or more. */
+#include "../src/dwm-win32.c"
+#include "fakewin.h"
+
+#define NCLIENTS 200
+#define ROUNDS 100
+#define SWITCHES 200
+#define MAXHANDLES 10000
+#define MAXFOCUS 5000
+#define MAXTILE 500
+#define BURST 10
+#define LOOKUPS 100000
+#define NPROBES 4096
+#define RUNTIME 0.2 /* seconds per timed loop */
+
+static unsigned int failures;
+
+/* class names and titles of windows found on a Windows 10 desktop */
+static const wchar_t *recorded[][2] = {
+	{ L"Shell_TrayWnd", L"" },
+	{ L"Progman", L"Program Manager" },
+	{ L"ForegroundStaging", L"" },
+	{ L"ApplicationManager_DesktopShellWindow", L"" },
+	{ L"Windows.UI.Core.CoreWindow", L"Start" },
+	{ L"Windows.UI.Core.CoreWindow", L"Search" },
+	{ L"Windows.UI.Core.CoreWindow", L"Cortana" },
+	{ L"Windows.UI.Core.CoreWindow", L"Action center" },
+	{ L"Windows.UI.Core.CoreWindow", L"Windows Shell Experience Host" },
+	{ L"Windows.UI.Core.CoreWindow", L"Microsoft Text Input Application" },
+	{ L"Windows.UI.Core.CoreWindow", L"Calculator" },
+	{ L"Windows.UI.Core.CoreWindow", L"Settings" },
+	{ L"ApplicationFrameWindow", L"Calculator" },
+	{ L"ApplicationFrameWindow", L"Settings" },
+	{ L"CabinetWClass", L"Documents" },
+	{ L"Chrome_WidgetWin_1", L"New Tab - Google Chrome" },
+	{ L"MozillaWindowClass", L"Mozilla Firefox" },
+	{ L"ConsoleWindowClass", L"Command Prompt" },
+	{ L"Notepad", L"Untitled - Notepad" },
+	{ L"tooltips_class32", L"" },
+	{ L"IME", L"Default IME" },
+	{ L"MSCTFIME UI", L"MSCTFIME UI" },
+	{ L"Static", L"" },
+	{ L"Scrollbar", L"" },
+};
+
+static double
+now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned int
+moves(void) {
+	return fakecalls.setwindowpos + fakecalls.deferred;
+}
+
+/* getclient() as it was before the index, a walk of the client list */
+static Client *
+walkclients(Client *head, HWND hwnd) {
+	Client *c;
+
+	for (c = head; c && c->hwnd != hwnd; c = c->next);
+	return c;
+}
+
+/* lookups per second of n synthetic handles in the index and by walking
+ * a list of them, half of the handles looked up are unknown */
+static void
+benchlookup(unsigned int n) {
+	static Client *cs[MAXHANDLES];
+	static HWND probes[NPROBES];
+	Client *head = NULL;
+	unsigned int i, runs, found;
+	double t, indexrate, walkrate;
+
+	for (i = n; i > 0; i--) {
+		cs[i - 1] = allocclient();
+		cs[i - 1]->hwnd = (HWND)(uintptr_t)(0x10000 + 8 * (i - 1));
+		cs[i - 1]->next = head;
+		head = cs[i - 1];
+		indexclient(cs[i - 1]);
+	}
+	for (i = 0; i < NPROBES; i++)
+		probes[i] = (HWND)(uintptr_t)(0x10000 + 4 * (rand() % (2 * n)));
+
+	found = runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < NPROBES; i++)
+			found += getclient(probes[i]) != NULL;
+		runs += NPROBES;
+	} while (now() - t < RUNTIME);
+	indexrate = runs / (now() - t);
+
+	runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < NPROBES / 16; i++)
+			found -= walkclients(head, probes[i]) != NULL;
+		runs += NPROBES / 16;
+	} while (now() - t < RUNTIME);
+	walkrate = runs / (now() - t);
+
+	printf("%8u %16.0f %16.0f %8.0fx\n", n, indexrate, walkrate, indexrate / walkrate);
+	for (i = 0; i < n; i++) {
+		unindexclient(cs[i]);
+		freeclient(cs[i]);
+	}
+}
+
+static HWND
+newclient(unsigned int i) {
+	wchar_t title[32];
+
+	swprintf(title, LENGTH(title), L"client %u", i);
+	return fakecreate(L"FakeApp", title, WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+}
+
+/* moves per manage and unmanage of one window next to NCLIENTS others,
+ * after a tag switch hid and showed all of them once */
+static void
+benchmanage(const Layout *l) {
+	HWND clienthwnds[NCLIENTS], hwnd;
+	unsigned int i, managemoves = 0, unmanagemoves = 0, m;
+	double t, managetime = 0, unmanagetime = 0;
+
+	setlayout(&(Arg){ .v = (void *)l });
+	for (i = 0; i < NCLIENTS; i++)
+		clienthwnds[i] = newclient(i);
+	fakepump();
+	view(&(Arg){ .ui = 1 << 1 });
+	fakepump();
+	view(&(Arg){ .ui = 1 << 0 });
+	fakepump();
+
+	for (i = 0; i < ROUNDS; i++) {
+		hwnd = newclient(NCLIENTS);
+		m = moves();
+		t = now();
+		fakepump();
+		managetime += now() - t;
+		managemoves += moves() - m;
+
+		fakedestroy(hwnd);
+		m = moves();
+		t = now();
+		fakepump();
+		unmanagetime += now() - t;
+		unmanagemoves += moves() - m;
+	}
+	printf("%-8ls %8u %14.1f %16.1f %12.1f %14.1f\n", l->symbol, NCLIENTS,
+	       (double)managemoves / ROUNDS, (double)unmanagemoves / ROUNDS,
+	       managetime / ROUNDS * 1e6, unmanagetime / ROUNDS * 1e6);
+
+	for (i = 0; i < NCLIENTS; i++)
+		fakedestroy(clienthwnds[i]);
+	fakepump();
+}
+
+static void
+viewtag(unsigned int i) {
+	view(&(Arg){ .ui = 1 << (~i & 1) });
+}
+
+static void
+toggletag2(unsigned int i) {
+	toggleview(&(Arg){ .ui = 1 << 1 });
+}
+
+static void
+fliplayout(unsigned int i) {
+	setlayout(NULL);
+}
+
+/* layout runs, memo hits, moves and time per run of op on two tags of
+ * NCLIENTS / 2 clients */
+static void
+benchswitch(const char *name, void (*op)(unsigned int i)) {
+	unsigned int i, hits = memohits, misses = memomisses, m = moves();
+	double t;
+
+	t = now();
+	for (i = 0; i < SWITCHES; i++) {
+		op(i);
+		fakepump();
+	}
+	t = now() - t;
+	hits = memohits - hits;
+	misses = memomisses - misses;
+	m = moves() - m;
+	printf("%-12s %8u %12u %10u %9.1f%% %13.1f %10.1f\n", name, SWITCHES, misses, hits,
+	       100.0 * hits / (hits + misses), (double)m / SWITCHES, t / SWITCHES * 1e6);
+}
+
+static void
+benchswitches(void) {
+	HWND clienthwnds[NCLIENTS];
+	unsigned int i;
+
+	setlayout(&(Arg){ .v = findlayout(L"[]=") });
+	for (i = 0; i < NCLIENTS; i++) {
+		if (i == NCLIENTS / 2) {
+			fakepump();
+			view(&(Arg){ .ui = 1 << 1 });
+		}
+		clienthwnds[i] = newclient(i);
+	}
+	fakepump();
+	view(&(Arg){ .ui = 1 << 0 });
+	fakepump();
+
+	printf("\n%-12s %8s %12s %10s %10s %13s %10s\n", "switch", "runs", "layout runs",
+	       "memo hits", "hit rate", "moves/switch", "us/switch");
+	benchswitch("view", viewtag);
+	benchswitch("toggleview", toggletag2);
+	benchswitch("setlayout", fliplayout);
+
+	/* the shell forgets hidden windows, show them before they go */
+	view(&(Arg){ .ui = ~0 });
+	fakepump();
+	for (i = 0; i < NCLIENTS; i++)
+		fakedestroy(clienthwnds[i]);
+	fakepump();
+}
+
+/* time per focusstack() through n clients, with the bar drawn as the
+ * user sees it and without, which leaves the list operations */
+static void
+benchfocus(unsigned int n) {
+	static HWND clienthwnds[MAXFOCUS];
+	HWND bar = barhwnd;
+	unsigned int i, runs;
+	double t, withbar, without;
+
+	setlayout(&(Arg){ .v = findlayout(L"[M]") });
+	for (i = 0; i < n; i++)
+		clienthwnds[i] = newclient(i);
+	fakepump();
+
+	runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < 1000; i++)
+			focusstack(&(Arg){ .i = +1 });
+		runs += 1000;
+	} while (now() - t < RUNTIME);
+	withbar = (now() - t) / runs;
+
+	barhwnd = NULL;
+	runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < 1000; i++)
+			focusstack(&(Arg){ .i = +1 });
+		runs += 1000;
+	} while (now() - t < RUNTIME);
+	without = (now() - t) / runs;
+	barhwnd = bar;
+
+	printf("%8u %14.0f %18.0f\n", n, withbar * 1e9, without * 1e9);
+	for (i = 0; i < n; i++)
+		fakedestroy(clienthwnds[i]);
+	fakepump();
+}
+
+/* tile() of layout.c written as a Lua layout, without piling up the
+ * stack, which needs minh */
+static const char luatile[] =
+	"require 'dwm.layout'.register('lua', function(n, area, g)\n"
+	"  if n == 0 then return end\n"
+	"  local mw = math.floor(area.w * area.mfact)\n"
+	"  g:set(1, area.x, area.y, n == 1 and area.w or mw, area.h)\n"
+	"  n = n - 1\n"
+	"  local q = math.floor(area.h / n)\n"
+	"  local rem = area.h % n\n"
+	"  for i = 0, n - 1 do\n"
+	"    g:set(i + 2, area.x + mw, area.y + i * q + math.min(i, rem), area.w - mw,\n"
+	"          q + (i < rem and 1 or 0))\n"
+	"  end\n"
+	"end)\n";
+
+/* us per run of tile() and of the Lua tile through runlayout() over n
+ * clients, which have to agree, and the bytes the Lua run allocates */
+static void
+benchluatile(unsigned int n) {
+	static int x[2][MAXTILE], y[2][MAXTILE], w[2][MAXTILE], h[2][MAXTILE];
+	static HWND clienthwnds[MAXTILE];
+	LayoutParams p = { wx, wy, ww, wh, mfact * (1 << MFACTBITS) + 0.5, 0 };
+	LayoutRects native = { x[0], y[0], w[0], h[0] }, lr = { x[1], y[1], w[1], h[1] };
+	const Layout *l = findlayout(L"lua");
+	unsigned int i, runs;
+	double t, c, luatime, bytes;
+
+	setlayout(&(Arg){ .v = findlayout(L"[]=") });
+	for (i = 0; i < n; i++)
+		clienthwnds[i] = newclient(i);
+	fakepump();
+	if (!l || geom.n != n) {
+		printf("luatile: %u of %u clients tiled\n", geom.n, n);
+		failures++;
+		for (i = 0; i < n; i++)
+			fakedestroy(clienthwnds[i]);
+		fakepump();
+		return;
+	}
+
+	runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < 100; i++)
+			tile(&p, n, &native);
+		runs += 100;
+	} while (now() - t < RUNTIME);
+	c = (now() - t) / runs;
+
+	/* with the collector stopped the heap grows by what the runs allocate */
+	lua_gc(lua, LUA_GCCOLLECT, 0);
+	lua_gc(lua, LUA_GCSTOP, 0);
+	bytes = lua_gc(lua, LUA_GCCOUNT, 0) * 1024.0 + lua_gc(lua, LUA_GCCOUNTB, 0);
+	runs = 0;
+	t = now();
+	do {
+		for (i = 0; i < 10; i++)
+			runlayout(l, &p, &lr);
+		runs += 10;
+	} while (now() - t < RUNTIME && runs < 100000);
+	luatime = (now() - t) / runs;
+	bytes = (lua_gc(lua, LUA_GCCOUNT, 0) * 1024.0 + lua_gc(lua, LUA_GCCOUNTB, 0) - bytes) / runs;
+	lua_gc(lua, LUA_GCRESTART, 0);
+
+	lua_getglobal(lua, "require");
+	lua_pushstring(lua, "dwm.layout");
+	lua_call(lua, 1, 1);
+	lua_getfield(lua, -1, "error");
+	if (!lua_isnil(lua, -1)) {
+		printf("luatile: %s\n", lua_tostring(lua, -1));
+		failures++;
+	}
+	lua_pop(lua, 2);
+	for (i = 0; i < n; i++)
+		if (x[0][i] != x[1][i] || y[0][i] != y[1][i] || w[0][i] != w[1][i] || h[0][i] != h[1][i]) {
+			printf("luatile: client %u is at %d,%d %dx%d instead of %d,%d %dx%d\n", i,
+			       x[1][i], y[1][i], w[1][i], h[1][i], x[0][i], y[0][i], w[0][i], h[0][i]);
+			failures++;
+			break;
+		}
+
+	printf("%8u %10.2f %10.2f %8.1fx %14.1f\n", n, c * 1e6, luatime * 1e6, luatime / c, bytes);
+	for (i = 0; i < n; i++)
+		fakedestroy(clienthwnds[i]);
+	fakepump();
+}
+
+/* the blocklists as ismanageable() checked them before isblocked() */
+static bool
+loopblocked(const wchar_t *classname, const wchar_t *title) {
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(blockedclasses); i++)
+		if (wcsstr(classname, blockedclasses[i]))
+			return true;
+	if (wcsstr(classname, L"Windows.UI.Core.CoreWindow"))
+		for (i = 0; i < LENGTH(blockedcorewindows); i++)
+			if (wcsstr(title, blockedcorewindows[i]))
+				return true;
+	return false;
+}
+
+/* ns per decision on the recorded windows, of isblocked(), of the loop
+ * it replaced and of ismanageable() as a whole with nothing remembered */
+static void
+benchblocked(void) {
+	HWND hwnds[LENGTH(recorded)];
+	volatile unsigned int sink = 0;
+	unsigned int i, k, runs, blocked = 0;
+	double t, matcher, loop, manage;
+
+	for (i = 0; i < LENGTH(recorded); i++) {
+		if (isblocked(recorded[i][0], recorded[i][1]) != loopblocked(recorded[i][0], recorded[i][1])) {
+			printf("blocklist: isblocked() and the loop disagree on %ls \"%ls\"\n",
+			       recorded[i][0], recorded[i][1]);
+			failures++;
+		}
+		blocked += isblocked(recorded[i][0], recorded[i][1]);
+		/* hidden, so that the shell has nothing to say about them */
+		hwnds[i] = fakecreate(recorded[i][0], recorded[i][1], WS_OVERLAPPEDWINDOW);
+		SetWindowLongW(hwnds[i], GWL_STYLE, WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	}
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < 1000; k++)
+			for (i = 0; i < LENGTH(recorded); i++)
+				sink += isblocked(recorded[i][0], recorded[i][1]);
+		runs += 1000 * LENGTH(recorded);
+	} while (now() - t < RUNTIME);
+	matcher = (now() - t) / runs;
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < 1000; k++)
+			for (i = 0; i < LENGTH(recorded); i++)
+				sink += loopblocked(recorded[i][0], recorded[i][1]);
+		runs += 1000 * LENGTH(recorded);
+	} while (now() - t < RUNTIME);
+	loop = (now() - t) / runs;
+
+	runs = 0;
+	t = now();
+	do {
+		for (k = 0; k < 100; k++)
+			for (i = 0; i < LENGTH(recorded); i++, runs++) {
+				forgetrejection(hwnds[i]);
+				sink += ismanageable(hwnds[i]);
+			}
+	} while (now() - t < RUNTIME);
+	manage = (now() - t) / runs;
+
+	printf("\n%8s %8s %12s %12s %16s\n", "windows", "blocked", "ns isblocked", "ns wcsstr", "ns ismanageable");
+	printf("%8u %8u %12.1f %12.1f %16.1f\n", (unsigned int)LENGTH(recorded), blocked,
+	       matcher * 1e9, loop * 1e9, manage * 1e9);
+	for (i = 0; i < LENGTH(recorded); i++)
+		fakedestroy(hwnds[i]);
+}
+
+/* a terminal retitled by the shell and the programs running in it, each
+ * title n times gap ms apart, %u counting up */
+static const struct {
+	const wchar_t *title;
+	unsigned int n, gap;
+} spam[] = {
+	{ L"Command Prompt", 1, 2000 },
+	{ L"Command Prompt - make [%u%%]", 100, 16 },
+	{ L"Command Prompt", 1, 3000 },
+	{ L"Command Prompt - vimrun.exe vim main.c", 1, 60000 },
+	{ L"Command Prompt - vimrun.exe vim main.c [%u lines]", 20, 250 },
+	{ L"Command Prompt - vimrun.exe vim main.c", 1, 30000 },
+	{ L"Command Prompt - git log [%u]", 200, 8 },
+	{ L"Command Prompt", 1, 1000 },
+	{ L"Command Prompt - ping example.com [%u]", 30, 1000 },
+	{ L"Command Prompt", 1, 5000 },
+};
+
+/* The spam replayed as name change events and the timer messages of the
+ * time passing between them. The title rules run once per title which
+ * stayed retitledelay ms, they used to run for every event. */
+static void
+benchretitle(void) {
+	HWND hwnd = fakecreate(L"ConsoleWindowClass", L"Command Prompt", WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	unsigned int i, k, events = retitleevents, runs = retitleruns, changes = retitlechanges;
+	unsigned int sent = 0, settled = 0;
+	unsigned int alive[RULEWORDS];
+	wchar_t title[128];
+	double t, replay, scans;
+	Client *c;
+
+	fakepump();
+	if (!(c = getclient(hwnd))) {
+		printf("retitle: the terminal is not managed\n");
+		failures++;
+		fakedestroy(hwnd);
+		fakepump();
+		return;
+	}
+	t = now();
+	for (i = 0; i < LENGTH(spam); i++)
+		for (k = 0; k < spam[i].n; k++) {
+			swprintf(title, LENGTH(title), spam[i].title, k);
+			fakesettitle(hwnd, title);
+			fakepump();
+			fakesleep(spam[i].gap);
+			fakepump();
+			sent++;
+			settled += spam[i].gap >= retitledelay;
+		}
+	replay = now() - t;
+	events = retitleevents - events;
+	runs = retitleruns - runs;
+	changes = retitlechanges - changes;
+
+	/* the time it took to scan all rules on every event */
+	t = now();
+	for (i = 0; i < events; i++) {
+		c->attrs->valid &= ~(1 << AttrTitle);
+		memcpy(alive, rulemask, sizeof alive);
+		matchrules(c, alive);
+	}
+	scans = now() - t;
+
+	printf("\n%8s %8s %10s %10s %14s %12s %14s\n", "events", "settled", "rule runs", "changes",
+	       "runs/settled", "us replay", "us all scanned");
+	printf("%8u %8u %10u %10u %14.2f %12.1f %14.1f\n", events, settled, runs, changes,
+	       (double)runs / settled, replay * 1e6, scans * 1e6);
+	/* vimrun.exe floats the terminal and the prompt sinks it again */
+	if (runs != settled || changes != 2 || events != sent) {
+		printf("retitle: %u events, %u rule runs and %u changes for %u settled titles\n",
+		       events, runs, changes, settled);
+		failures++;
+	}
+	fakedestroy(hwnd);
+	fakepump();
+}
+
+/* dispatches the queued messages, stopping before WM_ARRANGE if flush is
+ * false, and arranging after each of them as before the coalescing if it
+ * is true */
+static void
+dispatchburst(bool flush) {
+	MSG msg;
+
+	while (PeekMessageW(&msg, NULL, 0, 0, PM_NOREMOVE)) {
+		if (!flush && msg.message == WM_ARRANGE)
+			return;
+		PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE);
+		DispatchMessageW(&msg);
+		if (flush)
+			flusharrange();
+	}
+}
+
+/* An application closing its BURST windows next to n others, arrange
+ * requests and runs of the burst before and after the posted WM_ARRANGE
+ * is dispatched, and the moves it cost against an arrange per event. */
+static void
+benchburst(unsigned int n) {
+	static HWND clienthwnds[NCLIENTS];
+	HWND app[BURST];
+	unsigned int i, requests, runs, before, m, coalesced, each;
+
+	setlayout(&(Arg){ .v = findlayout(L"[]=") });
+	for (i = 0; i < n; i++)
+		clienthwnds[i] = newclient(i);
+	for (i = 0; i < BURST; i++)
+		app[i] = newclient(n + i);
+	fakepump();
+
+	requests = arrangerequests;
+	runs = arranges;
+	m = moves();
+	for (i = 0; i < BURST; i++)
+		fakedestroy(app[i]);
+	dispatchburst(false);
+	before = arranges - runs;
+	fakepump();
+	coalesced = moves() - m;
+	requests = arrangerequests - requests;
+	runs = arranges - runs;
+
+	for (i = 0; i < BURST; i++)
+		app[i] = newclient(n + i);
+	fakepump();
+	m = moves();
+	for (i = 0; i < BURST; i++)
+		fakedestroy(app[i]);
+	dispatchburst(true);
+	each = moves() - m;
+
+	printf("%8u %8u %9u %14u %13u %15u %15u\n", n, BURST, requests, before, runs, coalesced, each);
+	if (requests != BURST || before != 0 || runs != 1) {
+		printf("burst: %u requests ran %u arranges, %u before WM_ARRANGE\n", requests, runs, before);
+		failures++;
+	}
+	for (i = 0; i < n; i++)
+		fakedestroy(clienthwnds[i]);
+	fakepump();
+}
+
+/* the image name as it was fetched before the cache, on every lookup */
+static const wchar_t *
+queryprocess(DWORD pid) {
+	static wchar_t name[MAX_PATH];
+	DWORD size = MAX_PATH;
+	HANDLE h;
+
+	if (!(h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid)))
+		return NULL;
+	if (!QueryFullProcessImageNameW(h, 0, name, &size))
+		name[0] = L'\0';
+	CloseHandle(h);
+	return name[0] ? name : NULL;
+}
+
+/* OpenProcess and QueryFullProcessImageNameW calls and time per lookup of
+ * pid, which has to be named image, expecting opens calls to OpenProcess */
+static void
+benchprocess(const char *name, bool cached, DWORD pid, const wchar_t *image, unsigned int opens) {
+	unsigned int i, open = fakecalls.openprocess, query = fakecalls.queryimage;
+	const wchar_t *s = NULL;
+	double t;
+
+	t = now();
+	for (i = 0; i < LOOKUPS; i++) {
+		if (cached) {
+			ProcEntry *e = lookupprocess(pid);
+			s = e->h ? e->name : NULL;
+		} else {
+			s = queryprocess(pid);
+		}
+	}
+	t = now() - t;
+	open = fakecalls.openprocess - open;
+	query = fakecalls.queryimage - query;
+	printf("%-20s %8u %12u %12u %10.1f\n", name, LOOKUPS, open, query, t / LOOKUPS * 1e9);
+	if ((image ? !s || wcscmp(s, image) : s != NULL) || (cached && open != opens)) {
+		printf("%s: found %ls instead of %ls with %u OpenProcess\n", name,
+		       s ? s : L"nothing", image ? image : L"nothing", open);
+		failures++;
+	}
+}
+
+static void
+benchprocesses(void) {
+	printf("\n%-20s %8s %12s %12s %10s\n", "process lookup", "lookups", "OpenProcess",
+	       "image names", "ns/lookup");
+	fakestartprocess(4000, L"C:\\Windows\\explorer.exe", false);
+	benchprocess("uncached", false, 4000, L"C:\\Windows\\explorer.exe", LOOKUPS);
+	benchprocess("same pid", true, 4000, L"C:\\Windows\\explorer.exe", 1);
+	/* the handle the cache holds tells that the pid is a new process */
+	fakeexitprocess(4000);
+	fakestartprocess(4000, L"C:\\Windows\\notepad.exe", false);
+	benchprocess("reused pid", true, 4000, L"C:\\Windows\\notepad.exe", 1);
+	/* elevated processes are asked again after PROCDENIEDTTL only */
+	fakestartprocess(4004, L"C:\\Windows\\regedit.exe", true);
+	benchprocess("denied pid", true, 4004, NULL, 1);
+}
+
+int
+main(void) {
+	unsigned int i, runs, m;
+	lua_State *L;
+	double t;
+
+	/* keep the user's init.lua out of it */
+	setenv("XDG_CONFIG_HOME", "/nonexistent", 1);
+	if (!(L = luaL_newstate()))
+		return 2;
+	setup(L, NULL);
+	fakepump();
+
+	printf("%8s %16s %16s %9s\n", "handles", "index lookups/s", "list lookups/s", "speedup");
+	benchlookup(100);
+	benchlookup(1000);
+	benchlookup(MAXHANDLES);
+
+	printf("\n%-8s %8s %14s %16s %12s %14s\n", "layout", "clients",
+	       "moves/manage", "moves/unmanage", "us/manage", "us/unmanage");
+	benchmanage(findlayout(L"[]="));
+	benchmanage(findlayout(L"[M]"));
+	benchswitches();
+
+	printf("\n%8s %14s %18s\n", "clients", "ns/focusstack", "ns without the bar");
+	benchfocus(50);
+	benchfocus(500);
+	benchfocus(MAXFOCUS);
+
+	if (luaL_dostring(lua, luatile)) {
+		printf("luatile: %s\n", lua_tostring(lua, -1));
+		failures++;
+	} else {
+		printf("\n%8s %10s %10s %9s %14s\n", "clients", "us tile()", "us Lua", "slowdown", "Lua bytes/run");
+		benchluatile(50);
+		benchluatile(MAXTILE);
+	}
+	benchprocesses();
+	benchblocked();
+	benchretitle();
+
+
+	printf("\n%8s %8s %9s %14s %13s %15s %15s\n", "clients", "closed", "requests", "before arrange",
+	       "after arrange", "moves coalesced", "moves each");
+	benchburst(0);
+	benchburst(20);
+	benchburst(NCLIENTS);
+
+	/* cleanup() shows all windows in one arrange and lets them go */
+	for (i = 0; i < NCLIENTS; i++)
+		newclient(i);
+	fakepump();
+	view(&(Arg){ .ui = 1 << 1 });
+	fakepump();
+	runs = arranges;
+	m = moves();
+	t = now();
+	cleanup(L);
+	t = now() - t;
+	runs = arranges - runs;
+	printf("\n%8s %8s %8s %10s\n", "clients", "arranges", "moves", "us cleanup");
+	printf("%8u %8u %8u %10.1f\n", NCLIENTS, runs, moves() - m, t * 1e6);
+	if (runs != 1) {
+		printf("cleanup: %u arranges\n", runs);
+		failures++;
+	}
+	return failures != 0;
+}
@@ -0,0 +1,900 @@
+/* Tests of the window manager running on the fake window system of
+ * fakewin.c. Random sequences of the operations a user triggers run
+ * against it, after each one the windows have to be where a fresh run
+ * of the layout puts them, also when the fake DeferWindowPos
+ * transactions fail. */
+#include "../src/dwm-win32.c"
+#include "fakewin.h"
+
+#include <malloc.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAXCLIENTS 256
+#define STRESSWINDOWS 64
+#define CHAINDEPTH 12
+#define STRESSRUNS 1000000
+
+static HWND clienthwnds[MAXCLIENTS];
+static unsigned int nclients, failures;
+
+/* run by setup(), before the bar and the dwm window exist */
+static const char initlua[] =
+	"local layout = require 'dwm.layout'\n"
+	"layout.set('[M]')\n"
+	"layout.register('nan', function(n, area, g)\n"
+	"  nanset = pcall(g.set, g, 1, 0/0, area.y, area.w, area.h)\n"
+	"  hugeset = pcall(g.set, g, 1, area.x, area.y, 2^40, area.h)\n"
+	"end)\n";
+
+static void
+newclient(void) {
+	wchar_t title[32];
+
+	if (nclients == MAXCLIENTS)
+		return;
+	swprintf(title, LENGTH(title), L"client %u", nclients);
+	clienthwnds[nclients++] = fakecreate(L"FakeApp", title, WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+}
+
+static void
+destroyclient(unsigned int i) {
+	fakedestroy(clienthwnds[i]);
+	clienthwnds[i] = clienthwnds[--nclients];
+}
+
+static void
+destroyclients(void) {
+	view(&(Arg){ .ui = ~0 });
+	fakepump();
+	while (nclients)
+		destroyclient(0);
+	fakepump();
+}
+
+static void
+randomop(void) {
+	unsigned int r = rand() % 9;
+
+	switch (r) {
+	case 0:
+		newclient();
+		break;
+	case 1:
+		/* windows on hidden tags are gone from the shell's view, closing
+		 * them would leave clients behind as on Windows */
+		if (nclients && IsWindowVisible(clienthwnds[r = rand() % nclients]))
+			destroyclient(r);
+		break;
+	case 2:
+		view(&(Arg){ .ui = 1 << rand() % 3 });
+		break;
+	case 3:
+		toggleview(&(Arg){ .ui = 1 << rand() % 3 });
+		break;
+	case 4:
+		setlayout(&(Arg){ .v = &layouts[rand() % LENGTH(layouts)] });
+		break;
+	case 5:
+		setlayout(NULL);
+		break;
+	case 6:
+		setmfact(&(Arg){ .f = rand() % 2 ? 0.05 : -0.05 });
+		break;
+	case 7:
+		tag(&(Arg){ .ui = 1 << rand() % 3 });
+		break;
+	case 8:
+		zoom(NULL);
+		break;
+	}
+	fakepump();
+}
+
+/* the tiled windows are where the layout puts them when run afresh */
+static void
+checkgeometry(const char *name, unsigned int op) {
+	static int x[MAXCLIENTS], y[MAXCLIENTS], w[MAXCLIENTS], h[MAXCLIENTS];
+	LayoutParams p = { wx, wy, ww, wh, mfact * (1 << MFACTBITS) + 0.5, bh };
+	LayoutRects r = { x, y, w, h };
+	unsigned int i;
+	FakeWindow *f;
+	Client *c;
+
+	/* Lua layouts can't be run afresh from here */
+	if (!lt[sellt]->arrange || lt[sellt]->ref)
+		return;
+	lt[sellt]->arrange(&p, geom.n, &r);
+	for (i = 0; i < geom.n; i++) {
+		c = geom.c[i];
+		f = fakewindow(c->hwnd);
+		if (f && f->x == x[i] && f->y == y[i]
+		&& f->w == MAX(w[i] - 2 * c->bw, bh) && f->h == MAX(h[i] - 2 * c->bw, bh))
+			continue;
+		if (failures++ < 10)
+			printf("%s: after operation %u, client %u of %u is at %d,%d %dx%d instead of %d,%d %dx%d\n",
+			       name, op, i, geom.n, f ? f->x : -1, f ? f->y : -1, f ? f->w : -1, f ? f->h : -1,
+			       x[i], y[i], w[i], h[i]);
+	}
+}
+
+/* remembered layout results put the windows where the layout would */
+static void
+testmemo(void) {
+	unsigned int i, hits = memohits;
+
+	srand(1);
+	while (nclients < 60)
+		newclient();
+	fakepump();
+	for (i = 0; i < 400; i++) {
+		randomop();
+		checkgeometry("memo", i);
+	}
+	if (memohits == hits) {
+		printf("memo: the layout memo was never used\n");
+		failures++;
+	}
+	destroyclients();
+}
+
+/* the windows end up in place whether the DeferWindowPos transactions
+ * of arrange() are committed, fail on the faildefer-th DeferWindowPos or
+ * fail in EndDeferWindowPos */
+static void
+testmoves(const char *name, unsigned int faildefer, bool failend) {
+	unsigned int i, deferred = batchmoves, commits = batchcommits, fallbacks = batchfallbacks;
+
+	fakefaildefer = faildefer;
+	fakefailend = failend;
+	srand(2);
+	while (nclients < 40)
+		newclient();
+	fakepump();
+	for (i = 0; i < 200; i++) {
+		randomop();
+		checkgeometry(name, i);
+	}
+	if (batchmoves == deferred) {
+		printf("%s: no move was deferred\n", name);
+		failures++;
+	}
+	if (failend != (batchcommits == commits)) {
+		printf("%s: %u transactions committed\n", name, batchcommits - commits);
+		failures++;
+	}
+	if ((faildefer || failend) == (batchfallbacks == fallbacks)) {
+		printf("%s: %u windows moved one by one\n", name, batchfallbacks - fallbacks);
+		failures++;
+	}
+	fakefaildefer = 0;
+	fakefailend = false;
+	destroyclients();
+}
+
+static unsigned int minimized, floating; /* seen by checktiled() */
+
+/* the tiled vector holds the visible clients which are neither floating
+ * nor minimized, in list order, as found by walking the clients list.
+ * The bar's count of clients per tag is right as well. */
+static void
+checktiled(const char *name, unsigned int op) {
+	unsigned int i, n = 0, counts[LENGTH(tags)] = { 0 };
+	bool tiled;
+	Client *c;
+
+	for (c = clients; c; c = c->next) {
+		for (i = 0; i < LENGTH(tags); i++)
+			counts[i] += (c->tags & 1 << i) != 0;
+		minimized += c->isminimized;
+		floating += c->isfloating;
+		tiled = ISVISIBLE(c) && !c->isfloating && !c->isminimized;
+		if (c->istiled != tiled) {
+			if (failures++ < 10)
+				printf("%s: after operation %u, client %p is %stiled\n",
+				       name, op, (void *)c->hwnd, c->istiled ? "" : "not ");
+		} else if (tiled && (n >= geom.n || geom.c[n++] != c)) {
+			if (failures++ < 10)
+				printf("%s: after operation %u, tiled client %u is out of place\n", name, op, n - 1);
+		}
+	}
+	if (n != geom.n && failures++ < 10)
+		printf("%s: after operation %u, %u clients are tiled instead of %u\n", name, op, geom.n, n);
+	for (i = 0; i < LENGTH(tags); i++)
+		if (tagclients[i] != counts[i] && failures++ < 10)
+			printf("%s: after operation %u, tag %u has %u clients instead of %u\n",
+			       name, op, i + 1, tagclients[i], counts[i]);
+}
+
+/* the selected window is minimized as another one is activated, and
+ * restored as it is activated itself */
+static void
+minimizeop(void) {
+	HWND hwnd = clienthwnds[rand() % nclients];
+	Client *c = getclient(hwnd);
+
+	if (!c || !ISVISIBLE(c))
+		return;
+	if (c->isminimized) {
+		fakewindow(hwnd)->style &= ~WS_MINIMIZE;
+		fakeactivate(hwnd);
+	} else if (sel && sel != c) {
+		fakewindow(sel->hwnd)->style |= WS_MINIMIZE;
+		fakeactivate(hwnd);
+	}
+}
+
+/* the tiled vector follows the operations changing which clients are tiled */
+static void
+testtiled(void) {
+	unsigned int i;
+
+	srand(4);
+	while (nclients < 50)
+		newclient();
+	fakepump();
+	checktiled("tiled", 0);
+	for (i = 1; i <= 1000; i++) {
+		switch (rand() % 6) {
+		case 0:
+			view(&(Arg){ .ui = 1 << rand() % 3 });
+			break;
+		case 1:
+			tag(&(Arg){ .ui = 1 << rand() % 3 });
+			break;
+		case 2:
+			toggletag(&(Arg){ .ui = 1 << rand() % 3 });
+			break;
+		case 3:
+			togglefloating(NULL);
+			break;
+		case 4:
+			minimizeop();
+			break;
+		case 5:
+			setselected(getclient(clienthwnds[rand() % nclients]));
+			break;
+		}
+		fakepump();
+		checktiled("tiled", i);
+	}
+	if (!minimized || !floating) {
+		printf("tiled: %u minimized and %u floating clients seen\n", minimized, floating);
+		failures++;
+	}
+	for (i = 0; i < nclients; i++)
+		fakewindow(clienthwnds[i])->style &= ~WS_MINIMIZE;
+	destroyclients();
+}
+
+/* Every client with a parent window is in exactly one list: the child
+ * list of the client managing its parent, or the orphans list when no
+ * client does. The lists are linked in both directions. */
+static void
+checkchildren(const char *name, unsigned int step) {
+	unsigned int n = 0, linked = 0;
+	Client *c, *p, *prev;
+
+	for (c = clients; c; c = c->next) {
+		if (c->parent != GetParent(c->hwnd) || (!c->parent && (c->pclient || c->cnext || c->cprev))
+		|| (c->parent && c->pclient != getclient(c->parent))) {
+			if (failures++ < 10)
+				printf("%s: after step %u, client %p has parent client %p instead of %p\n", name, step,
+				       (void *)c->hwnd, (void *)c->pclient, (void *)getclient(c->parent));
+		}
+		n += c->parent != NULL;
+	}
+	/* the orphans list comes first, then the child list of every client */
+	for (p = NULL, c = orphans; ; c = p->children) {
+		for (prev = NULL; c; prev = c, c = c->cnext, linked++) {
+			if (c->cprev == prev && c->pclient == p && getclient(c->hwnd) == c)
+				continue;
+			if (failures++ < 10)
+				printf("%s: after step %u, client %p is linked below %p\n", name, step,
+				       (void *)c->hwnd, p ? (void *)p->hwnd : NULL);
+			break;
+		}
+		if (!(p = p ? p->next : clients))
+			break;
+	}
+	if (linked != n && failures++ < 10)
+		printf("%s: after step %u, %u of %u child clients are linked\n", name, step, linked, n);
+}
+
+/* A chain of child windows CHAINDEPTH deep hangs off a top-level window,
+ * every window has a second child besides the next one in the chain. Each
+ * unmanaged window leaves its children orphaned until it is managed
+ * again. */
+static void
+testchildren(void) {
+	HWND chain[CHAINDEPTH], leaves[CHAINDEPTH], hwnd;
+	unsigned int i, step = 0, managed = 0;
+	Client *c;
+
+	chain[0] = fakecreate(L"FakeApp", L"top", WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	for (i = 1; i < CHAINDEPTH; i++)
+		chain[i] = fakecreatechild(chain[i - 1], L"FakeTool", L"chain",
+		                           WS_VISIBLE, i % 2 ? WS_EX_TOOLWINDOW : WS_EX_APPWINDOW);
+	for (i = 0; i < CHAINDEPTH; i++)
+		leaves[i] = fakecreatechild(chain[i], L"FakeTool", L"leaf", WS_VISIBLE, WS_EX_TOOLWINDOW);
+	/* the top-level window shows up and brings its descendants along */
+	fakepump();
+	for (i = 0; i < CHAINDEPTH; i++)
+		managed += getclient(chain[i]) && getclient(leaves[i]);
+	if (managed != CHAINDEPTH) {
+		printf("children: the windows of only %u levels are managed\n", managed);
+		failures++;
+	}
+	checkchildren("children", step++);
+
+	/* unmanage the middle of the chain, then the top, and bring both back */
+	if (managed == CHAINDEPTH) {
+		unmanage(getclient(chain[CHAINDEPTH / 2]));
+		checkchildren("children", step++);
+		if (getclient(chain[CHAINDEPTH / 2 + 1])->pclient && failures++ < 10)
+			printf("children: the child of an unmanaged window has a parent client\n");
+		unmanage(getclient(chain[0]));
+		checkchildren("children", step++);
+		scan(chain[CHAINDEPTH / 2], 0);
+		checkchildren("children", step++);
+		c = manage(chain[0]);
+		checkchildren("children", step++);
+		managechildwindows(c);
+		checkchildren("children", step++);
+		for (i = 1; i < CHAINDEPTH; i++)
+			if ((c = getclient(chain[i])) && c->pclient != getclient(chain[i - 1]) && failures++ < 10)
+				printf("children: window %u of the chain is below %p\n", i, (void *)c->pclient);
+		fakepump();
+	}
+
+	/* every window goes, children of unmanaged windows first */
+	for (i = CHAINDEPTH; i-- > 0; ) {
+		if ((c = getclient(leaves[i])))
+			unmanage(c);
+		fakedestroy(leaves[i]);
+		hwnd = chain[i];
+		if ((c = getclient(hwnd)))
+			unmanage(c);
+		fakedestroy(hwnd);
+		checkchildren("children", step++);
+	}
+	fakepump();
+}
+
+/* Manages and unmanages windows a million times. After a warm-up in
+ * which every window was managed at once, the pool gets no more slabs and
+ * the heap stays the same size. A reference to an unmanaged client never
+ * leads to the client reusing its pool slot. */
+static void
+teststress(void) {
+	HWND hwnds[STRESSWINDOWS];
+	Client *cs[STRESSWINDOWS] = { NULL };
+	ClientRef gone = { NULL, 0 };
+	unsigned int i, k, slabs = 0, allocs, frees, reused = 0;
+	size_t heap = 0;
+
+	srand(3);
+	/* hidden, so that the shell has nothing to say about them */
+	for (i = 0; i < STRESSWINDOWS; i++)
+		hwnds[i] = fakecreate(L"FakeApp", L"stress", WS_OVERLAPPEDWINDOW);
+	for (i = 0; i < STRESSWINDOWS; i++)
+		cs[i] = manage(hwnds[i]);
+	fakepump();
+	allocs = nclientallocs;
+	frees = nclientfrees;
+	for (i = 0; i < STRESSRUNS; i++) {
+		if (i == STRESSRUNS / 10) {
+			slabs = nslabs;
+			heap = mallinfo2().uordblks;
+		}
+		k = rand() % STRESSWINDOWS;
+		if (cs[k]) {
+			gone = clientref(cs[k]);
+			unmanage(cs[k]);
+			cs[k] = NULL;
+		} else {
+			cs[k] = manage(hwnds[k]);
+			if (cs[k] == gone.c) {
+				reused++;
+				if (getclientref(gone) && failures++ < 10)
+					printf("stress: a stale reference led to the client in its slot\n");
+			}
+		}
+		if (i % 64 == 0)
+			fakepump();
+	}
+	fakepump();
+	if (nslabs != slabs || mallinfo2().uordblks > heap) {
+		printf("stress: grew from %u to %u slabs, from %zu to %zu bytes of heap\n",
+		       slabs, nslabs, heap, mallinfo2().uordblks);
+		failures++;
+	}
+	if (!reused) {
+		printf("stress: no pool slot was reused\n");
+		failures++;
+	}
+	printf("stress: %u runs, %u client allocations and %u frees from %u slabs, %zu bytes of heap\n",
+	       STRESSRUNS, nclientallocs - allocs, nclientfrees - frees, nslabs, heap);
+
+	for (i = 0; i < STRESSWINDOWS; i++) {
+		if (cs[i])
+			unmanage(cs[i]);
+		fakedestroy(hwnds[i]);
+	}
+	fakepump();
+}
+
+/* calls the attribute getters of c over and over, returning the calls
+ * of GetWindowTextW, GetClassNameW and DwmGetWindowAttribute made */
+static unsigned int
+getattrs(Client *c) {
+	unsigned int i, calls = fakecalls.gettext + fakecalls.getclass + fakecalls.cloaked;
+
+	for (i = 0; i < 100; i++) {
+		clienttitle(c);
+		clientclassname(c);
+		clientcloaked(c);
+	}
+	return fakecalls.gettext + fakecalls.getclass + fakecalls.cloaked - calls;
+}
+
+/* the attributes of a client are fetched once, a title is fetched again
+ * after the window says it changed, and the cloak events tell whether a
+ * window is cloaked without asking */
+static void
+testattrs(void) {
+	HWND hwnd = fakecreate(L"FakeApp", L"before", WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	unsigned int calls, text;
+	Client *c;
+
+	fakepump();
+	if (!(c = getclient(hwnd))) {
+		printf("attrs: the window is not managed\n");
+		failures++;
+		fakedestroy(hwnd);
+		fakepump();
+		return;
+	}
+	if ((calls = getattrs(c))) {
+		printf("attrs: %u calls fetching cached attributes\n", calls);
+		failures++;
+	}
+
+	/* the title is fetched once, by the bar or by the getters */
+	text = fakecalls.gettext;
+	fakesettitle(hwnd, L"after");
+	fakepump();
+	getattrs(c);
+	if (fakecalls.gettext - text != 1 || wcscmp(clienttitle(c), L"after")) {
+		printf("attrs: %u GetWindowTextW after the title changed to %ls\n",
+		       fakecalls.gettext - text, clienttitle(c));
+		failures++;
+	}
+
+	fakecloak(hwnd, false);
+	fakepump();
+	if ((calls = getattrs(c)) || clientcloaked(c)) {
+		printf("attrs: %u calls after the window was uncloaked\n", calls);
+		failures++;
+	}
+
+	/* cloaked windows are left alone until they come back */
+	fakecloak(hwnd, true);
+	fakepump();
+	if (getclient(hwnd)) {
+		printf("attrs: a cloaked window is managed\n");
+		failures++;
+	}
+	fakecloak(hwnd, false);
+	fakepump();
+	if (!(c = getclient(hwnd))) {
+		printf("attrs: an uncloaked window is not managed\n");
+		failures++;
+	} else if ((calls = getattrs(c))) {
+		printf("attrs: %u calls fetching the attributes of the uncloaked window\n", calls);
+		failures++;
+	}
+
+	fakedestroy(hwnd);
+	fakepump();
+}
+
+/* fails unless the rejection cache was hit and missed as often as expected
+ * since the counts were hits and misses */
+static void
+checkrejections(const char *what, unsigned int hits, unsigned int misses, unsigned int wanthits, unsigned int wantmisses) {
+	if (rejecthits - hits == wanthits && rejectmisses - misses == wantmisses)
+		return;
+	printf("rejections: %s gave %u hits and %u misses instead of %u and %u\n", what,
+	       rejecthits - hits, rejectmisses - misses, wanthits, wantmisses);
+	failures++;
+}
+
+/* A stream of shell messages and window events about a window which is
+ * not managed. Its rejection is remembered until an event may have
+ * changed the window, or the window is gone and its handle is reused by
+ * one which is manageable. */
+static void
+testrejections(void) {
+	HWND hwnd = fakecreate(L"Progman", L"Program Manager", WS_OVERLAPPEDWINDOW | WS_VISIBLE), reused;
+	unsigned int hits = rejecthits, misses = rejectmisses, i;
+
+	fakepump();
+	checkrejections("creating", hits, misses, 0, 1);
+
+	/* activating it asks again, the answer is remembered */
+	hits = rejecthits;
+	misses = rejectmisses;
+	for (i = 0; i < 3; i++)
+		fakeactivate(hwnd);
+	fakepump();
+	checkrejections("activating", hits, misses, 3, 0);
+
+	/* any event drops the rejection */
+	hits = rejecthits;
+	misses = rejectmisses;
+	fakesettitle(hwnd, L"Program Manager");
+	fakeactivate(hwnd);
+	fakeactivate(hwnd);
+	fakepump();
+	checkrejections("renaming", hits, misses, 1, 1);
+
+	/* a style which changed without an event doesn't match the rejection */
+	hits = rejecthits;
+	misses = rejectmisses;
+	fakewindow(hwnd)->exstyle |= WS_EX_WINDOWEDGE;
+	fakeactivate(hwnd);
+	fakeactivate(hwnd);
+	fakepump();
+	fakewindow(hwnd)->exstyle &= ~WS_EX_WINDOWEDGE;
+	fakeactivate(hwnd);
+	fakepump();
+	checkrejections("restyling", hits, misses, 1, 2);
+
+	/* the handle comes back as a window of another class looking the same */
+	hits = rejecthits;
+	misses = rejectmisses;
+	fakedestroy(hwnd);
+	fakepump();
+	fakenexthandle(hwnd);
+	reused = fakecreate(L"FakeApp", L"Program Manager", WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	fakepump();
+	checkrejections("reusing", hits, misses, 0, 1);
+	if (reused != hwnd || !getclient(reused)) {
+		printf("rejections: the window reusing the handle of a rejected one is not managed\n");
+		failures++;
+	}
+	fakedestroy(reused);
+	fakepump();
+}
+
+/* whether the file at path starts with line, and has no line starting with
+ * not if that is given */
+static bool
+fileis(const char *path, const char *line, const char *not) {
+	char buf[512];
+	bool ok;
+	FILE *f;
+
+	if (!(f = fopen(path, "r")))
+		return false;
+	ok = fgets(buf, sizeof buf, f) && !strncmp(buf, line, strlen(line));
+	while (ok && not && fgets(buf, sizeof buf, f))
+		ok = strncmp(buf, not, strlen(not));
+	fclose(f);
+	return ok;
+}
+
+/* Rules count their hits. The cost of fetching and matching a field is
+ * charged to the rules which could still match when it was fetched, and
+ * dumprulestats() writes one line per rule into a file of its own. */
+static void
+testrulestats(const char *dir) {
+	static const struct {
+		const wchar_t *class, *title;
+		unsigned int rule; /* in config.h.in */
+	} windows[] = {
+		{ L"CabinetWClass", L"Documents", 8 },
+		{ L"OpusApp", L"Letter - Word", 12 },
+		{ L"Chrome_WidgetWin_1", L"New Tab - Google Chrome", 15 },
+		{ L"Chrome_WidgetWin_1", L"Downloads - Google Chrome", 15 },
+	};
+	static const char header[] = "rule,class,title,processname,hits,fetch.class,fetch.title,fetch.process,match\n";
+	HWND hwnds[LENGTH(windows)];
+	unsigned int i, k, hits, lines = 0;
+	char buf[512], cwd[256], want[64];
+	FILE *f;
+
+	memset(rulestats, 0, sizeof rulestats);
+	for (i = 0; i < LENGTH(windows); i++)
+		hwnds[i] = fakecreate(windows[i].class, windows[i].title, WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	fakepump();
+	for (i = 0; i < LENGTH(rules); i++) {
+		for (hits = 0, k = 0; k < LENGTH(windows); k++)
+			hits += windows[k].rule == i;
+		if (rulestats[i].hits != hits && failures++ < 10)
+			printf("rulestats: rule %u has %u hits instead of %u\n", i, rulestats[i].hits, hits);
+	}
+	/* no window has the class of the Snipping Tool or of Excel, so their
+	 * titles and processes were fetched for others */
+	if (rulestats[2].fetch[FieldTitle] || rulestats[10].fetch[FieldProcess]) {
+		printf("rulestats: rules which could not match were charged for fetching\n");
+		failures++;
+	}
+
+	if (!(f = tmpfile()))
+		return;
+	dumprulestats(f);
+	rewind(f);
+	snprintf(want, sizeof want, "%u,\"%ls\",,,%u,", windows[0].rule, windows[0].class, 1);
+	if (!fgets(buf, sizeof buf, f) || strcmp(buf, header)) {
+		printf("rulestats: the csv starts with %s", buf);
+		failures++;
+	}
+	while (fgets(buf, sizeof buf, f))
+		if (lines++ == windows[0].rule && strncmp(buf, want, strlen(want))) {
+			printf("rulestats: the line of rule %u is %s", windows[0].rule, buf);
+			failures++;
+		}
+	if (lines != LENGTH(rules)) {
+		printf("rulestats: the csv has %u lines of rules instead of %u\n", lines, (unsigned int)LENGTH(rules));
+		failures++;
+	}
+	fclose(f);
+
+	/* the csv goes next to the counters, not into them */
+	if (getcwd(cwd, sizeof cwd) && !chdir(dir)) {
+		writestats();
+		if (!fileis("dwm-win32-rules.csv", header, NULL) || !fileis("dwm-win32-stats.log", "pool.slabs=", "rule,")) {
+			printf("rulestats: the stats files are mixed up\n");
+			failures++;
+		}
+		unlink("dwm-win32-rules.csv");
+		unlink("dwm-win32-stats.log");
+		if (chdir(cwd))
+			failures++;
+	}
+
+	for (i = 0; i < LENGTH(windows); i++)
+		fakedestroy(hwnds[i]);
+	fakepump();
+}
+
+/* compiles custom into the rule matchers in place of the rules of
+ * config.h.in, the last of custom fills the rest of rules[], or puts the
+ * rules of config.h.in back if custom is NULL */
+static void
+swaprules(const Rule *custom, unsigned int n) {
+	static Rule saved[LENGTH(rules)];
+	unsigned int i, f;
+
+	if (custom) {
+		memcpy(saved, rules, sizeof saved);
+		for (i = 0; i < LENGTH(rules); i++)
+			rules[i] = custom[i < n ? i : n - 1];
+	} else {
+		memcpy(rules, saved, sizeof rules);
+	}
+	for (f = 0; f < FieldLast; f++)
+		matchfree(rulematchers[f]);
+	memset(ruleany, 0, sizeof ruleany);
+	memset(rulemask, 0, sizeof rulemask);
+	memset(rulerefs, 0, sizeof rulerefs);
+	compilerules();
+}
+
+/* A field is fetched only while a rule which constrains it can still
+ * match, counted in the calls reaching the window system: titles and
+ * processes of windows whose class no rule names stay unasked. */
+static void
+testfetches(void) {
+	static const Rule custom[] = {
+		{ L"Alpha", L"T", NULL, 0, false, false, MatchExact },
+		{ L"Beta", NULL, L"beta.exe", 0, false, false, MatchExact },
+		{ L"Gamma", NULL, NULL, 0, false, false, MatchExact },
+	};
+	static const struct {
+		const wchar_t *class, *title;
+		unsigned int getclass, gettext, processid, skips; /* skipped fields */
+	} windows[] = {
+		{ L"Other", L"Title", 1, 0, 0, 2 },
+		{ L"Alpha", L"Title", 1, 1, 0, 1 },
+		{ L"Alpha", L"title", 1, 1, 0, 1 },
+		{ L"Beta", L"Title", 1, 0, 1, 1 },
+	};
+	unsigned int alive[RULEWORDS], i, f, getclass, gettext, processid, skips, skipped;
+	HWND hwnd;
+	Client *c;
+
+	swaprules(custom, LENGTH(custom));
+	for (i = 0; i < LENGTH(windows); i++) {
+		hwnd = fakecreate(windows[i].class, windows[i].title, WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+		fakepump();
+		if (!(c = getclient(hwnd))) {
+			printf("fetches: %ls is not managed\n", windows[i].class);
+			failures++;
+			fakedestroy(hwnd);
+			fakepump();
+			continue;
+		}
+		c->attrs->valid = 0;
+		getclass = fakecalls.getclass;
+		gettext = fakecalls.gettext;
+		processid = fakecalls.processid;
+		for (skips = 0, f = 0; f < FieldLast; f++)
+			skips += fieldskips[f];
+		memcpy(alive, rulemask, sizeof alive);
+		matchrules(c, alive);
+		for (skipped = 0, f = 0; f < FieldLast; f++)
+			skipped += fieldskips[f];
+		skipped -= skips;
+		if (fakecalls.getclass - getclass != windows[i].getclass
+		|| fakecalls.gettext - gettext != windows[i].gettext
+		|| fakecalls.processid - processid != windows[i].processid || skipped != windows[i].skips) {
+			printf("fetches: %ls \"%ls\" took %u class, %u title and %u process calls skipping %u fields\n",
+			       windows[i].class, windows[i].title, fakecalls.getclass - getclass,
+			       fakecalls.gettext - gettext, fakecalls.processid - processid, skipped);
+			failures++;
+		}
+		fakedestroy(hwnd);
+		fakepump();
+	}
+	swaprules(NULL, 0);
+}
+
+/* Title rules are applied again once a title stayed the same for
+ * retitledelay ms. Their tags are added, as when the window was managed,
+ * and stay when the title stops matching. */
+static void
+testretitle(void) {
+	static const Rule custom[] = {
+		{ NULL, L"vim", NULL, 1 << 1, false, false, MatchSubstring },
+	};
+	unsigned int runs = retitleruns, changes = retitlechanges, tags;
+	HWND hwnd;
+	Client *c;
+
+	swaprules(custom, LENGTH(custom));
+	hwnd = fakecreate(L"ConsoleWindowClass", L"bash", WS_OVERLAPPEDWINDOW | WS_VISIBLE);
+	fakepump();
+	if (!(c = getclient(hwnd))) {
+		printf("retitle: the window is not managed\n");
+		failures++;
+		fakedestroy(hwnd);
+		fakepump();
+		swaprules(NULL, 0);
+		return;
+	}
+	tags = c->tags;
+
+	fakesettitle(hwnd, L"vim main.c");
+	fakepump();
+	fakesleep(retitledelay - 1);
+	fakepump();
+	if (retitleruns != runs) {
+		printf("retitle: rules applied before the title settled\n");
+		failures++;
+	}
+	fakesleep(1);
+	fakepump();
+	if (retitleruns - runs != 1 || retitlechanges - changes != 1 || c->tags != (tags | 1 << 1)) {
+		printf("retitle: %u runs and %u changes left the tags at %#x\n", retitleruns - runs,
+		       retitlechanges - changes, c->tags);
+		failures++;
+	}
+
+	fakesettitle(hwnd, L"bash");
+	fakepump();
+	fakesleep(retitledelay);
+	fakepump();
+	if (c->tags != (tags | 1 << 1)) {
+		printf("retitle: the tags are %#x after the title stopped matching\n", c->tags);
+		failures++;
+	}
+	fakedestroy(hwnd);
+	fakepump();
+	swaprules(NULL, 0);
+}
+
+/* the layout init.lua selects is the one of the first tag only, and
+ * selecting it drew no bar over the screen */
+static void
+testinit(void) {
+	if (fakecalls.screendc) {
+		printf("init: the bar was drawn on the screen %u times\n", fakecalls.screendc);
+		failures++;
+	}
+	if (lt[sellt] != findlayout(L"[M]")) {
+		printf("init: the first tag has layout %ls instead of [M]\n", lt[sellt]->symbol);
+		failures++;
+	}
+	view(&(Arg){ .ui = 1 << 1 });
+	fakepump();
+	if (lt[sellt] != &layouts[0]) {
+		printf("init: the second tag has layout %ls instead of %ls\n", lt[sellt]->symbol, layouts[0].symbol);
+		failures++;
+	}
+	view(&(Arg){ .ui = 1 << 0 });
+	fakepump();
+}
+
+static bool
+luaglobal(const char *name) {
+	bool b;
+
+	lua_getglobal(lua, name);
+	b = lua_toboolean(lua, -1);
+	lua_pop(lua, 1);
+	return b;
+}
+
+/* geometry:set() refuses coordinates an int can't hold, on a tag of its
+ * own to keep the Lua layout away from the other tests */
+static void
+testgeometryset(void) {
+	view(&(Arg){ .ui = 1 << 3 });
+	newclient();
+	fakepump();
+	setlayout(&(Arg){ .v = findlayout(L"nan") });
+	fakepump();
+	if (luaglobal("nanset") || luaglobal("hugeset")) {
+		printf("geometry: set took%s%s\n", luaglobal("nanset") ? " NaN" : "",
+		       luaglobal("hugeset") ? " 2^40" : "");
+		failures++;
+	}
+	destroyclients();
+}
+
+int
+main(void) {
+	char dir[] = "/tmp/wmtestXXXXXX", path[64];
+	lua_State *L;
+	FILE *f;
+
+	/* an init.lua of our own instead of the user's */
+	if (!mkdtemp(dir))
+		return 2;
+	snprintf(path, sizeof path, "%s/.config", dir);
+	mkdir(path, 0700);
+	snprintf(path, sizeof path, "%s/.config/dwm", dir);
+	mkdir(path, 0700);
+	snprintf(path, sizeof path, "%s/.config/dwm/init.lua", dir);
+	if (!(f = fopen(path, "w")))
+		return 2;
+	fputs(initlua, f);
+	fclose(f);
+	setenv("XDG_CONFIG_HOME", dir, 1);
+	if (!(L = luaL_newstate()))
+		return 2;
+	setup(L, NULL);
+	fakepump();
+
+	testinit();
+	testgeometryset();
+	testmemo();
+	testattrs();
+	testrejections();
+	testrulestats(dir);
+	testfetches();
+	testretitle();
+	testtiled();
+	testchildren();
+	teststress();
+	testmoves("commit", 0, false);
+	testmoves("defer fails", 3, false);
+	testmoves("end fails", 0, true);
+
+	cleanup(L);
+	unlink(path);
+	snprintf(path, sizeof path, "%s/.config/dwm", dir);
+	rmdir(path);
+	snprintf(path, sizeof path, "%s/.config", dir);
+	rmdir(path);
+	rmdir(dir);
+	if (failures) {
+		printf("wmtest: %u failures\n", failures);
+		return 1;
+	}
+	printf("wmtest: ok\n");
+	return 0;
+}